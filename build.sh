@@ -7,4 +7,4 @@ if ! command -v gcc &> /dev/null; then
 fi
 
 # Compiling the csv library
-g++ -o libcsv.so -fpic -shared csv-processor/src/csv-processor.cpp
\ No newline at end of file
+g++ -O2 -pthread -o libcsv.so -fpic -shared csv-processor-cpp/src/*.cpp
\ No newline at end of file
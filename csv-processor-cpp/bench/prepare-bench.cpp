@@ -0,0 +1,65 @@
+#include "../includes/csv-processor.hpp"
+#include <chrono>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Microbenchmark of the query preparation: the filter lexer used by csvQueryPrepare against
+// the std::regex parsing it replaced (copied below as the baseline)
+
+// Baseline: the regex is built for every filter line, as the old preprocessFilters did
+static size_t parseWithRegex(const std::string& rowFilterDefinitions) {
+    size_t parsed = 0;
+    std::istringstream filterStream(rowFilterDefinitions);
+    std::string filterDefinition;
+    while (std::getline(filterStream, filterDefinition, '\n')) {
+        std::regex re(R"(([^<>=!=>=<=]+)([><=!=]{1,2})([^<>=!=>=<=]+))");
+        std::smatch match;
+        if (std::regex_match(filterDefinition, match, re)) {
+            std::string headerColumnName = match[1];
+            std::string comparator = match[2];
+            std::string value = match[3];
+            parsed += headerColumnName.size() + comparator.size() + value.size();
+        }
+    }
+    return parsed;
+}
+
+// Returns the average time of each call of function, in microseconds
+template <typename Function>
+static double measure(int iterations, Function&& function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        function();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 2000;
+
+    for (int filterCount : {1, 10, 50}) {
+        std::string rowFilterDefinitions;
+        const char* comparators[] = {">", "<", "=", "!=", ">=", "<="};
+        for (int i = 0; i < filterCount; ++i) {
+            if (i > 0) rowFilterDefinitions += "\n";
+            rowFilterDefinitions += "column" + std::to_string(i % 8) + comparators[i % 6] + "value" + std::to_string(i);
+        }
+
+        size_t checksum = 0;
+        double regexTime = measure(iterations, [&] { checksum += parseWithRegex(rowFilterDefinitions); });
+        double lexerTime = measure(iterations, [&] {
+            CsvQuery* query = csvQueryPrepare("", rowFilterDefinitions.c_str());
+            checksum += query != nullptr;
+            csvQueryFree(query);
+        });
+
+        std::cout << filterCount << " filters: regex " << regexTime << " us, lexer " << lexerTime
+                  << " us, speedup " << regexTime / lexerTime << "x (checksum " << checksum << ")" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "../includes/csv-processor.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Throughput of the parser with and without RFC 4180 quoting, on a CSV without quotes
+// and on the same CSV with every text field quoted (half of them with a comma inside)
+
+// Builds a CSV of rowCount rows: an id, two text fields and a number
+static std::string buildCsv(int rowCount, bool quoteFields) {
+    std::string csv = "id,name,city,amount\n";
+    for (int i = 0; i < rowCount; ++i) {
+        std::string name = "name" + std::to_string(i % 1000);
+        std::string city = "city" + std::to_string(i % 37);
+        if (quoteFields) {
+            name = "\"" + name + (i % 2 == 0 ? ", jr" : "") + "\"";
+            city = "\"" + city + "\"";
+        }
+        csv += std::to_string(i) + "," + name + "," + city + "," + std::to_string(i % 5000) + "\n";
+    }
+    return csv;
+}
+
+// The output is only counted, so the benchmark measures the parsing and the filters
+static void countOutput(void* context, const char*, size_t size) {
+    *static_cast<size_t*>(context) += size;
+}
+
+// Returns the throughput of the query on the csv, in MB/s
+static double measure(CsvQuery* query, const std::string& csv, int iterations, size_t& outputSize) {
+    CsvSink sink = csvCallbackSink(countOutput, &outputSize);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        csvQueryRunToSink(query, csv.c_str(), &sink);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return csv.size() * static_cast<double>(iterations) / elapsed.count() / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int rowCount = argc > 1 ? std::stoi(argv[1]) : 1000000;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::string unquotedCsv = buildCsv(rowCount, false);
+    std::string quotedCsv = buildCsv(rowCount, true);
+
+    CsvQuery* query = csvQueryPrepare("id,name,amount", "city=city7\namount>2500");
+    if (query == nullptr) return 1;
+
+    const struct { const char* name; const std::string* csv; CsvQuoteMode quoteMode; } cases[] = {
+        {"unquoted CSV, no quoting     ", &unquotedCsv, CSV_QUOTES_NONE},
+        {"unquoted CSV, permissive mode", &unquotedCsv, CSV_QUOTES_PERMISSIVE},
+        {"quoted CSV, permissive mode  ", &quotedCsv, CSV_QUOTES_PERMISSIVE},
+        {"quoted CSV, strict mode      ", &quotedCsv, CSV_QUOTES_STRICT},
+    };
+    for (const auto& entry : cases) {
+        csvQuerySetQuoteMode(query, entry.quoteMode);
+        size_t outputSize = 0;
+        double throughput = measure(query, *entry.csv, iterations, outputSize);
+        std::cout << entry.name << ": " << throughput << " MB/s (output " << outputSize / iterations << " bytes)" << std::endl;
+    }
+
+    csvQueryFree(query);
+    return 0;
+}
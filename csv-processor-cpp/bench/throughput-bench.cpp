@@ -0,0 +1,328 @@
+#include "../includes/csv-processor.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Throughput (MB/s and rows/s) of processCsv and processCsvFile on synthetic CSVs, for every combination of the
+// sizes, widths, field lengths, quote densities and selectivities given. The CSVs are generated from a seed,
+// so the same options always measure the same data. The results are written as CSV, one line per measure, and
+// can be compared with the results of a previous build to catch regressions:
+//
+//   build/throughput-bench --rows 100000,1000000 --columns 4,32 --selectivity 0.01,0.5 --output results.csv
+//   build/throughput-bench ... --baseline results.csv --tolerance 0.1
+//
+// The output is counted and discarded by a callback sink, so only the library is measured
+// (processCsv and processCsvFile are processCsvToSink and processCsvFileToSink with the sink of std::cout)
+
+struct BenchOptions
+{
+    std::vector<size_t> rows = {200000};
+    std::vector<size_t> columns = {4, 16, 64};
+    std::vector<size_t> fieldLengths = {8};
+    std::vector<double> quoteDensities = {0, 0.2};
+    std::vector<double> selectivities = {0.01, 0.5, 1};
+    int iterations = 3;
+    int threads = 0; // 0 uses the default of the library
+    uint64_t seed = 1;
+    std::string csvFile = "build/throughput-bench-data.csv";
+    std::string output = "build/throughput-bench-results.csv";
+    std::string baseline;
+    double tolerance = 0.1;
+};
+
+// Shape of a generated CSV
+struct CsvShape
+{
+    size_t rows;
+    size_t columns;
+    size_t fieldLength;
+    double quoteDensity;
+    double selectivity;
+};
+
+// One line of the results
+struct BenchResult
+{
+    std::string benchmark;
+    CsvShape shape;
+    size_t inputBytes;
+    size_t outputBytes;
+    double seconds; // Best time of the iterations
+    double megabytesPerSecond;
+    double rowsPerSecond;
+};
+
+// Pseudo random generator (splitmix64). It's used instead of <random> so the data is the same with any standard library
+class SplitMix
+{
+public:
+    explicit SplitMix(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t state;
+};
+
+// Values of the key column, written with 4 digits so the text comparison of the filter is also the numeric one
+constexpr int kKeyValues = 10000;
+
+// Builds a CSV with the shape: c0 is the row number, c1 the key of the filter (uniform in [0, kKeyValues))
+// and the others random text. A quoteDensity of the text fields is quoted, and half of those have a comma
+// and an escaped quote inside, so the quoted fields are only read right with quoting
+static std::string buildCsv(const CsvShape& shape, uint64_t seed) {
+    SplitMix random(seed);
+    std::string csv;
+    for (size_t column = 0; column < shape.columns; ++column) {
+        csv += (column > 0 ? ",c" : "c") + std::to_string(column);
+    }
+    csv += '\n';
+
+    char key[8];
+    for (size_t row = 0; row < shape.rows; ++row) {
+        csv += std::to_string(row);
+        std::snprintf(key, sizeof(key), ",%04d", static_cast<int>(random.next() % kKeyValues));
+        csv += key;
+        for (size_t column = 2; column < shape.columns; ++column) {
+            csv += ',';
+            bool quoted = random.uniform() < shape.quoteDensity;
+            if (quoted) csv += '"';
+            for (size_t i = 0; i < shape.fieldLength; ++i) {
+                csv += static_cast<char>('a' + random.next() % 26);
+            }
+            if (quoted && random.next() % 2 == 0) csv += ", \"\"x\"\"";
+            if (quoted) csv += '"';
+        }
+        csv += '\n';
+    }
+    return csv;
+}
+
+// Filter on the key column matching about a selectivity of the rows
+static std::string buildFilter(double selectivity) {
+    if (selectivity >= 1) {
+        return "c1<=" + std::to_string(kKeyValues - 1);
+    }
+    char filter[16];
+    std::snprintf(filter, sizeof(filter), "c1<%04d", static_cast<int>(selectivity * kKeyValues + 0.5));
+    return filter;
+}
+
+// The output is only counted, so the benchmark measures the parsing and the filters
+static void countOutput(void* context, const char*, size_t size) {
+    *static_cast<size_t*>(context) += size;
+}
+
+// Runs the benchmark the given iterations and returns the best time. run writes the output in the sink
+template <typename Run>
+static double measure(int iterations, size_t& outputBytes, Run&& run) {
+    double best = 0;
+    for (int i = 0; i < iterations; ++i) {
+        outputBytes = 0;
+        CsvSink sink = csvCallbackSink(countOutput, &outputBytes);
+        auto start = std::chrono::steady_clock::now();
+        run(&sink);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+static std::string formatDouble(double value) {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+}
+
+static const char kResultsHeader[] = "benchmark,rows,columns,field_length,quote_density,selectivity,threads,input_bytes,"
+                                     "output_bytes,seconds,mb_per_second,rows_per_second";
+
+// Identifies a measure of the results, to compare it with the same one in the baseline
+static std::string resultKey(const std::string& benchmark, const CsvShape& shape, int threads) {
+    return benchmark + "," + std::to_string(shape.rows) + "," + std::to_string(shape.columns) + "," + std::to_string(shape.fieldLength)
+         + "," + formatDouble(shape.quoteDensity) + "," + formatDouble(shape.selectivity) + "," + std::to_string(threads);
+}
+
+static bool writeResults(const std::string& path, const std::vector<BenchResult>& results, int threads) {
+    std::ofstream file(path);
+    if (!file) return false;
+    file << kResultsHeader << '\n';
+    for (const BenchResult& result : results) {
+        file << resultKey(result.benchmark, result.shape, threads) << ',' << result.inputBytes << ',' << result.outputBytes
+             << ',' << result.seconds << ',' << result.megabytesPerSecond << ',' << result.rowsPerSecond << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+// Reads the MB/s of every measure of a results file, by key. Returns false if the file can't be read
+static bool readBaseline(const std::string& path, std::map<std::string, double>& throughputs) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    std::getline(file, line); // Header
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::istringstream lineStream(line);
+        std::string field;
+        while (std::getline(lineStream, field, ',')) fields.push_back(field);
+        if (fields.size() != 12) continue;
+
+        std::string key = fields[0];
+        for (int i = 1; i < 7; ++i) key += "," + fields[i];
+        throughputs[key] = std::stod(fields[10]);
+    }
+    return true;
+}
+
+template <typename T>
+static std::vector<T> parseList(const std::string& text) {
+    std::vector<T> values;
+    std::istringstream stream(text);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(static_cast<T>(std::stod(value)));
+    }
+    return values;
+}
+
+static bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i += 2) {
+        std::string name = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[i + 1];
+        if (name == "--rows") options.rows = parseList<size_t>(value);
+        else if (name == "--columns") options.columns = parseList<size_t>(value);
+        else if (name == "--field-length") options.fieldLengths = parseList<size_t>(value);
+        else if (name == "--quote-density") options.quoteDensities = parseList<double>(value);
+        else if (name == "--selectivity") options.selectivities = parseList<double>(value);
+        else if (name == "--iterations") options.iterations = std::stoi(value);
+        else if (name == "--threads") options.threads = std::stoi(value);
+        else if (name == "--seed") options.seed = std::stoull(value);
+        else if (name == "--csv-file") options.csvFile = value;
+        else if (name == "--output") options.output = value;
+        else if (name == "--baseline") options.baseline = value;
+        else if (name == "--tolerance") options.tolerance = std::stod(value);
+        else return false;
+    }
+    // The key column and the filter need at least 2 columns
+    for (size_t columns : options.columns) {
+        if (columns < 2) return false;
+    }
+    return options.iterations > 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    bool validOptions;
+    try {
+        validOptions = parseOptions(argc, argv, options);
+    } catch (const std::exception&) {
+        validOptions = false; // A number that can't be parsed
+    }
+    if (!validOptions) {
+        std::cerr << "Usage: throughput-bench [--rows N,...] [--columns N,...] [--field-length N,...] [--quote-density D,...]\n"
+                     "                        [--selectivity D,...] [--iterations N] [--threads N] [--seed N] [--csv-file PATH]\n"
+                     "                        [--output PATH] [--baseline PATH] [--tolerance D]" << std::endl;
+        return 1;
+    }
+    setCsvThreadCount(options.threads);
+
+    std::vector<BenchResult> results;
+    for (size_t rows : options.rows)
+    for (size_t columns : options.columns)
+    for (size_t fieldLength : options.fieldLengths)
+    for (double quoteDensity : options.quoteDensities)
+    for (double selectivity : options.selectivities) {
+        CsvShape shape = {rows, columns, fieldLength, quoteDensity, selectivity};
+        std::string csv = buildCsv(shape, options.seed);
+        std::ofstream(options.csvFile, std::ios::binary).write(csv.data(), csv.size());
+
+        // The first and the last columns are selected, so every field of a row is split
+        std::string selectedColumns = "c0,c" + std::to_string(columns - 1);
+        std::string filter = buildFilter(selectivity);
+
+        // With quoted fields, the quote aware parsing is measured too, with prepared queries
+        CsvQuery* quotedQuery = nullptr;
+        if (quoteDensity > 0) {
+            quotedQuery = csvQueryPrepare(selectedColumns.c_str(), filter.c_str());
+            if (quotedQuery == nullptr) return 1;
+            csvQuerySetQuoteMode(quotedQuery, CSV_QUOTES_PERMISSIVE);
+        }
+
+        auto addResult = [&](const std::string& benchmark, size_t outputBytes, double seconds) {
+            results.push_back({benchmark, shape, csv.size(), outputBytes, seconds, csv.size() / seconds / 1e6, rows / seconds});
+            const BenchResult& result = results.back();
+            std::cout << benchmark << " rows=" << rows << " columns=" << columns << " field_length=" << fieldLength
+                      << " quote_density=" << quoteDensity << " selectivity=" << selectivity << ": "
+                      << result.megabytesPerSecond << " MB/s, " << result.rowsPerSecond << " rows/s (output "
+                      << outputBytes << " bytes)" << std::endl;
+        };
+
+        size_t outputBytes;
+        double seconds = measure(options.iterations, outputBytes, [&](CsvSink* sink) {
+            processCsvToSink(csv.c_str(), selectedColumns.c_str(), filter.c_str(), sink);
+        });
+        addResult("processCsv", outputBytes, seconds);
+
+        seconds = measure(options.iterations, outputBytes, [&](CsvSink* sink) {
+            processCsvFileToSink(options.csvFile.c_str(), selectedColumns.c_str(), filter.c_str(), sink);
+        });
+        addResult("processCsvFile", outputBytes, seconds);
+
+        if (quotedQuery != nullptr) {
+            seconds = measure(options.iterations, outputBytes, [&](CsvSink* sink) {
+                csvQueryRunToSink(quotedQuery, csv.c_str(), sink);
+            });
+            addResult("csvQueryRun-quoted", outputBytes, seconds);
+
+            seconds = measure(options.iterations, outputBytes, [&](CsvSink* sink) {
+                csvQueryRunFileToSink(quotedQuery, options.csvFile.c_str(), sink);
+            });
+            addResult("csvQueryRunFile-quoted", outputBytes, seconds);
+            csvQueryFree(quotedQuery);
+        }
+    }
+    std::remove(options.csvFile.c_str());
+
+    if (!writeResults(options.output, results, options.threads)) {
+        std::cerr << "Error writing the results to " << options.output << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << options.output << std::endl;
+
+    // A measure is a regression if its throughput is lower than the one of the baseline by more than the tolerance
+    if (options.baseline.empty()) {
+        return 0;
+    }
+    std::map<std::string, double> baseline;
+    if (!readBaseline(options.baseline, baseline)) {
+        std::cerr << "Error reading the baseline " << options.baseline << std::endl;
+        return 1;
+    }
+    int regressions = 0;
+    for (const BenchResult& result : results) {
+        auto it = baseline.find(resultKey(result.benchmark, result.shape, options.threads));
+        if (it == baseline.end()) continue;
+        if (result.megabytesPerSecond < it->second * (1 - options.tolerance)) {
+            std::cout << "Regression: " << it->first << ": " << result.megabytesPerSecond << " MB/s, baseline "
+                      << it->second << " MB/s" << std::endl;
+            ++regressions;
+        }
+    }
+    std::cout << regressions << " regressions against " << options.baseline << std::endl;
+    return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,62 @@
+#include "../includes/csv-processor.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Throughput of the typed filters (integer, float and date columns parsed with std::from_chars)
+// against the lexicographical comparison of the same columns
+
+// Builds a CSV of rowCount rows with an integer, a float and a date column
+static std::string buildCsv(int rowCount) {
+    std::string csv = "id,amount,price,day\n";
+    for (int i = 0; i < rowCount; ++i) {
+        int day = 1 + i % 28;
+        csv += std::to_string(i) + "," + std::to_string((i * 7919) % 100000) + "," + std::to_string((i % 1000) / 8.0)
+             + ",2026-02-" + (day < 10 ? "0" : "") + std::to_string(day) + "\n";
+    }
+    return csv;
+}
+
+// The output is only counted, so the benchmark measures the parsing and the filters
+static void countOutput(void* context, const char*, size_t size) {
+    *static_cast<size_t*>(context) += size;
+}
+
+// Returns the throughput of the query on the csv, in MB/s
+static double measure(CsvQuery* query, const std::string& csv, int iterations, size_t& outputSize) {
+    CsvSink sink = csvCallbackSink(countOutput, &outputSize);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        csvQueryRunToSink(query, csv.c_str(), &sink);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return csv.size() * static_cast<double>(iterations) / elapsed.count() / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int rowCount = argc > 1 ? std::stoi(argv[1]) : 1000000;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::string csv = buildCsv(rowCount);
+
+    const struct { const char* name; const char* column; const char* filter; CsvColumnType type; } cases[] = {
+        {"integer", "amount", "amount>=50000", CSV_TYPE_INTEGER},
+        {"float  ", "price", "price<60.5", CSV_TYPE_FLOAT},
+        {"date   ", "day", "day>=2026-02-15", CSV_TYPE_DATE},
+    };
+    for (const auto& entry : cases) {
+        CsvQuery* query = csvQueryPrepare("id", entry.filter);
+        if (query == nullptr) return 1;
+
+        size_t textOutput = 0, typedOutput = 0;
+        double textThroughput = measure(query, csv, iterations, textOutput);
+        csvQuerySetColumnType(query, entry.column, entry.type);
+        double typedThroughput = measure(query, csv, iterations, typedOutput);
+        csvQueryFree(query);
+
+        std::cout << entry.name << ": text " << textThroughput << " MB/s, typed " << typedThroughput << " MB/s (output "
+                  << textOutput / iterations << " / " << typedOutput / iterations << " bytes)" << std::endl;
+    }
+
+    return 0;
+}
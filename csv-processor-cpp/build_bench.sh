@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Build directory
+BUILD_DIR=build
+
+# If the build directory does not exist, create it
+if [ ! -d "$BUILD_DIR" ]; then
+  mkdir $BUILD_DIR
+fi
+
+# Compiling the benchmarks against the shared object
+g++ -O2 -o $BUILD_DIR/prepare-bench bench/prepare-bench.cpp -L. -l:build/libcsv-processor.so
+g++ -O2 -o $BUILD_DIR/quoting-bench bench/quoting-bench.cpp -L. -l:build/libcsv-processor.so
+g++ -O2 -o $BUILD_DIR/typed-filter-bench bench/typed-filter-bench.cpp -L. -l:build/libcsv-processor.so
+g++ -O2 -o $BUILD_DIR/throughput-bench bench/throughput-bench.cpp -L. -l:build/libcsv-processor.so
+
+# Finished message
+echo "build_bench finished"
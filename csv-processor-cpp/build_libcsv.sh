@@ -8,8 +8,14 @@ if [ ! -d "$BUILD_DIR" ]; then
   mkdir $BUILD_DIR
 fi
 
+# With CSV_DEBUG_STATS=1, the library counts the allocations of the query arenas (see csvQueryGetStats)
+DEBUG_FLAGS=""
+if [ "$CSV_DEBUG_STATS" = "1" ]; then
+  DEBUG_FLAGS="-DCSV_DEBUG_STATS"
+fi
+
 # Compiling the shared object code
-g++ -o $BUILD_DIR/libcsv-processor.so -fpic -shared src/csv-processor.cpp
+g++ -O2 -pthread $DEBUG_FLAGS -o $BUILD_DIR/libcsv-processor.so -fpic -shared src/*.cpp
 
 
 # Finished message
@@ -0,0 +1,77 @@
+#ifndef AGGREGATE_TABLE_HPP
+#define AGGREGATE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "csv-query.hpp"
+
+// State of an aggregate of a group
+struct AggregateState
+{
+    uint64_t count = 0;      // Rows (COUNT(*)), non-empty values (COUNT), numbers (SUM, AVG) or typed values (MIN, MAX)
+    int64_t integerSum = 0;  // SUM and AVG, while every number is an integer and the sum fits in 64 bits
+    double floatSum = 0;     // SUM and AVG, once a number isn't an integer or the integer sum overflows
+    bool integral = true;
+    std::string raw;         // MIN and MAX: the value as written in the CSV
+    std::string text;        // MIN and MAX of text columns: the value compared (without quotes)
+    int64_t integerValue = 0; // MIN and MAX of integer and date columns
+    double floatValue = 0;    // MIN and MAX of float columns
+};
+
+// Groups of the aggregation mode with the state of their aggregates, in the order their first row was added.
+// The groups are found with an open addressing hash table (linear probing) keyed by the bytes of the grouping
+// fields, so adding a row of an existing group doesn't allocate. Each thread fills its own table, and the tables
+// are merged in the order of the slices, so the groups are written in the same order with any number of threads
+class AggregateTable
+{
+public:
+    explicit AggregateTable(const QueryPlan& plan);
+
+    // Add a row that satisfies the filters, where fieldAt(columnIndex) returns a field of the row as written in the CSV.
+    // The views returned by fieldAt must stay valid until add returns
+    template <typename FieldAt>
+    void add(FieldAt&& fieldAt) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            fields[i] = columns[i] >= 0 ? fieldAt(columns[i]) : std::string_view();
+        }
+        addFields();
+    }
+
+    // Add the groups of a table filled with the same plan, combining the states of the groups both have
+    void merge(const AggregateTable& other);
+
+    // Write one line per group: the grouping fields as written in the CSV and the aggregates, separated by commas.
+    // The first offset groups are skipped, and only up to limit groups are written after them
+    void write(std::string& output, size_t offset = 0, size_t limit = SIZE_MAX) const;
+
+private:
+    struct Group
+    {
+        size_t hash;
+        std::string key;    // Length (32 bits) and bytes of each grouping field, without quotes
+        std::string fields; // Grouping fields as written in the CSV, separated by commas
+    };
+
+    size_t groupColumnCount;
+    std::vector<Aggregate> aggregates;
+    bool quoted;
+    std::vector<int> columns;             // Grouping columns, then the column of each aggregate
+    std::vector<std::string_view> fields; // Fields of the row being added, one per element of columns
+
+    std::vector<Group> groups;
+    std::vector<AggregateState> states;   // aggregates.size() states per group
+    std::vector<uint32_t> slots;          // Index of a group plus 1, or 0 if the slot is empty. The size is a power of 2
+    std::string key;                      // Key of the row being added
+    std::string unquoted;
+
+    void addFields();
+    size_t findGroup(size_t hash, std::string_view groupKey, std::string_view groupFields);
+    void grow();
+    void update(AggregateState& state, const Aggregate& aggregate, std::string_view raw);
+    void combine(AggregateState& state, const Aggregate& aggregate, const AggregateState& other);
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef COLUMNAR_CACHE_HPP
+#define COLUMNAR_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/stat.h>
+
+// Columns with fewer distinct values than this (low cardinality columns) are dictionary encoded
+constexpr size_t kMaxDictionaryEntries = 1000;
+
+// How the values of a column are stored in the columnar cache
+enum class ColumnEncoding : uint64_t
+{
+    Plain,      // Offset and length of each value in the heap of the column
+    Dictionary  // Code of each value, and the offset and length of each distinct value (entry) in the heap
+};
+
+// Values of a column of the columnar cache, pointing into the mapped file
+struct ColumnView
+{
+    ColumnEncoding encoding;
+    const uint64_t* offsets;      // Plain: offset of each value in the heap. Dictionary: offset of each entry
+    const uint32_t* lengths;      // Plain: length of each value. Dictionary: length of each entry
+    const uint32_t* codes;        // Dictionary: entry of each value
+    size_t entryCount;            // Dictionary: number of entries
+    const char* heap;
+    size_t heapSize;
+
+    // Value of the entry of a dictionary encoded column
+    std::string_view entry(size_t code) const {
+        return std::string_view(heap + offsets[code], lengths[code]);
+    }
+
+    // Value of the column in the row
+    std::string_view value(size_t row) const {
+        if (encoding == ColumnEncoding::Dictionary) return entry(codes[row]);
+        return std::string_view(heap + offsets[row], lengths[row]);
+    }
+};
+
+// Binary columnar copy of a CSV file, stored next to it (see columnarCachePath). Each column is stored contiguously,
+// so a query only reads the columns it uses, and the rows are never split again.
+// The values are stored as they are in the CSV (with their quotes, if the cache was built with quoting)
+class ColumnarCache
+{
+public:
+    ColumnarCache() = default;
+    ~ColumnarCache();
+
+    ColumnarCache(const ColumnarCache&) = delete;
+    ColumnarCache& operator=(const ColumnarCache&) = delete;
+
+    // Map the cache in the path. Returns false if there's no cache, it's invalid, or it's stale for the CSV file
+    // (described by its stat and its data). Only the header and the extents of the arrays are checked here
+    bool open(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size);
+
+    // Check if the values of the rows [beginRow, endRow) of the column are inside its heap (and their codes are entries
+    // of its dictionary), so they can be read. Only the columns used by a query are checked, before they're read
+    bool isColumnValid(size_t index, size_t beginRow, size_t endRow) const;
+
+    bool isQuoted() const { return quoted; }
+    bool isUnterminated() const { return unterminated; } // With quoting, the CSV ends inside a quoted field
+    size_t rowCount() const { return rows; }
+    size_t columnCount() const { return columns.size(); }
+    const ColumnView& column(size_t index) const { return columns[index]; }
+
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+    bool quoted = false;
+    bool unterminated = false;
+    size_t rows = 0;
+    std::vector<ColumnView> columns;
+};
+
+// Path of the columnar cache of a CSV file
+std::string columnarCachePath(const char csvFilePath[]);
+
+// Build the columnar cache of the CSV in [data, data + size) and write it in the path. If dictionaryEncode is true,
+// the columns with fewer than kMaxDictionaryEntries distinct values are dictionary encoded.
+// The file is written in two passes over the CSV, so the memory used doesn't depend on its size.
+// Returns false if the file can't be written
+bool writeColumnarCache(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size,
+                        bool quoted, bool dictionaryEncode);
+
+#endif
@@ -1,12 +1,123 @@
 #ifndef CSV_PROCESSOR_H
 #define CSV_PROCESSOR_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct CsvQuery CsvQuery;
+
+typedef enum CsvSinkType
+{
+    CSV_SINK_STDOUT,
+    CSV_SINK_BUFFER,
+    CSV_SINK_FD,
+    CSV_SINK_CALLBACK
+} CsvSinkType;
+
+typedef enum CsvQuoteMode
+{
+    CSV_QUOTES_NONE,
+    CSV_QUOTES_PERMISSIVE,
+    CSV_QUOTES_STRICT
+} CsvQuoteMode;
+
+typedef enum CsvColumnType
+{
+    CSV_TYPE_TEXT,
+    CSV_TYPE_INTEGER,
+    CSV_TYPE_FLOAT,
+    CSV_TYPE_DATE
+} CsvColumnType;
+
+typedef struct CsvQueryStats
+{
+    size_t blocksScanned;
+    size_t blocksSkipped;
+    size_t arenaAllocations;
+    size_t arenaHeapBlocks;
+} CsvQueryStats;
+
+typedef enum CsvStatus
+{
+    CSV_OK,
+    CSV_ERROR_INVALID_QUERY,
+    CSV_ERROR_OPENING_FILE,
+    CSV_ERROR_INVALID_CSV,
+    CSV_ERROR_WRITING_OUTPUT,
+    CSV_ERROR_READING_INPUT,
+    CSV_ERROR_INTERNAL
+} CsvStatus;
+
+#define CSV_RESULT_MESSAGE_SIZE 256
+
+typedef struct CsvResult
+{
+    CsvStatus status;
+    char message[CSV_RESULT_MESSAGE_SIZE];
+} CsvResult;
+
+typedef void (*CsvWriteCallback)(void* context, const char* data, size_t size);
+
+typedef struct CsvSink
+{
+    CsvSinkType type;
+    char* buffer;
+    size_t capacity;
+    size_t size;
+    int fd;
+    CsvWriteCallback callback;
+    void* context;
+    int error;
+} CsvSink;
+
 void processCsv(const char* csv, const char* selectedColumns, const char* rowFilterDefinitions);
 void processCsvFile(const char* csvFilePath, const char* selectedColumns, const char* rowFilterDefinitions);
+void processCsvFileStream(const char* csvFilePath, const char* selectedColumns, const char* rowFilterDefinitions, size_t chunkSize);
+void processCsvAggregate(const char* csv, const char* selectedColumns, const char* aggregates, const char* rowFilterDefinitions);
+void processCsvFileAggregate(const char* csvFilePath, const char* selectedColumns, const char* aggregates, const char* rowFilterDefinitions);
+
+void processCsvToSink(const char* csv, const char* selectedColumns, const char* rowFilterDefinitions, CsvSink* sink);
+void processCsvFileToSink(const char* csvFilePath, const char* selectedColumns, const char* rowFilterDefinitions, CsvSink* sink);
+
+CsvResult processCsvChecked(const char* csv, const char* selectedColumns, const char* rowFilterDefinitions, CsvSink* sink);
+CsvResult processCsvFileChecked(const char* csvFilePath, const char* selectedColumns, const char* rowFilterDefinitions, CsvSink* sink);
+
+CsvSink csvStdoutSink(void);
+CsvSink csvBufferSink(char* buffer, size_t capacity);
+CsvSink csvFdSink(int fd);
+CsvSink csvCallbackSink(CsvWriteCallback callback, void* context);
+
+CsvQuery* csvQueryPrepare(const char* selectedColumns, const char* rowFilterDefinitions);
+void csvQueryRun(CsvQuery* query, const char* csv);
+void csvQueryRunFile(CsvQuery* query, const char* csvFilePath);
+void csvQueryRunToSink(CsvQuery* query, const char* csv, CsvSink* sink);
+void csvQueryRunFileToSink(CsvQuery* query, const char* csvFilePath, CsvSink* sink);
+void csvQueryRunFileRowsToSink(CsvQuery* query, const char* csvFilePath, size_t firstRow, size_t rowCount, CsvSink* sink);
+int csvQueryCount(CsvQuery* query, const char* csv, size_t* count);
+int csvQueryCountFile(CsvQuery* query, const char* csvFilePath, size_t* count);
+int csvQueryExists(CsvQuery* query, const char* csv);
+int csvQueryExistsFile(CsvQuery* query, const char* csvFilePath);
+void csvQuerySetQuoteMode(CsvQuery* query, CsvQuoteMode quoteMode);
+int csvQuerySetColumnType(CsvQuery* query, const char* column, CsvColumnType columnType);
+void csvQueryInferTypes(CsvQuery* query, int inferTypes);
+int csvQuerySetAggregates(CsvQuery* query, const char* aggregates);
+void csvQuerySetLimit(CsvQuery* query, size_t offset, size_t limit);
+CsvQueryStats csvQueryGetStats(const CsvQuery* query);
+void csvQueryFree(CsvQuery* query);
+
+CsvResult csvQueryPrepareChecked(const char* selectedColumns, const char* rowFilterDefinitions, CsvQuery** query);
+CsvResult csvQueryRunChecked(CsvQuery* query, const char* csv, CsvSink* sink);
+CsvResult csvQueryRunFileChecked(CsvQuery* query, const char* csvFilePath, CsvSink* sink);
+
+int csvBuildRowIndex(const char* csvFilePath, size_t rowsPerEntry, CsvQuoteMode quoteMode);
+int csvBuildZoneMap(const char* csvFilePath, size_t rowsPerBlock, CsvQuoteMode quoteMode);
+int csvBuildColumnarCache(const char* csvFilePath, CsvQuoteMode quoteMode, int dictionaryEncode);
+
+int setCsvScanLevel(const char* level);
+void setCsvThreadCount(int threadCount);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,322 @@
+#ifndef CSV_QUERY_HPP
+#define CSV_QUERY_HPP
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "csv-types.hpp"
+#include "query-arena.hpp"
+
+// The parsed state and the plan of a query live in the arenas of the query (see QueryArena): the containers are
+// allocated in them, and the names and values are views of text copied in them
+
+// Struct to store the header column name and its index
+struct HeaderColumn
+{
+    std::string_view name;
+    int index;
+};
+
+// Comparators accepted in the rowFilterDefinitions
+enum class Comparator
+{
+    Greater,      // >
+    Less,         // <
+    Equal,        // =
+    NotEqual,     // !=
+    GreaterEqual, // >=
+    LessEqual     // <=
+};
+
+// Filter as written in the rowFilterDefinitions. It refers to the column by name, since it doesn't depend on the CSV
+// A comparator made of comparator characters but not one of the valid ones (e.g. "=>") is kept as it's written:
+// as with the original regex parser, it's an error only once a row is checked against it
+struct FilterDefinition
+{
+    std::string_view columnName;
+    Comparator comparator;
+    std::string_view value;
+    std::string_view comparatorText;
+    bool validComparator;
+};
+
+// Struct to store the filter definition. The comparator is resolved and the value stored once,
+// so checking a row doesn't need to copy or compare any string besides the field itself.
+// For typed columns the value is also parsed once, and each field is parsed without allocating
+struct Filter
+{
+    int columnIndex;
+    Comparator comparator;
+    std::string_view value;
+    ColumnType type = ColumnType::Text;
+    int64_t integerValue = 0; // Integer and Date (microseconds since the epoch) columns
+    double floatValue = 0;    // Float columns
+};
+
+// Filters of the same column, stored in [begin, end) of FilterPlan::filters.
+// A row satisfies the group if it satisfies any of its filters
+struct FilterGroup
+{
+    int columnIndex;
+    int begin;
+    int end;
+};
+
+// Filters compiled by preprocessFilters. The filters are sorted by column and each filtered column has a group
+struct FilterPlan
+{
+    std::pmr::vector<Filter> filters;
+    std::pmr::vector<FilterGroup> groups;
+
+    explicit FilterPlan(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : filters(resource), groups(resource) {}
+};
+
+// Functions of the aggregation mode
+enum class AggregateFunction
+{
+    Count,   // COUNT(*) counts the rows, COUNT(column) the non-empty values
+    Sum,     // The values that are numbers
+    Minimum, // Compared with the type of the column
+    Maximum,
+    Average  // The values that are numbers
+};
+
+// Aggregate as written in the aggregates of a query, e.g. SUM(amount). The column is empty for COUNT(*)
+struct AggregateDefinition
+{
+    AggregateFunction function;
+    std::string_view columnName;
+    std::string_view text; // Written as the name of the aggregate in the output header
+};
+
+// Aggregate bound to a column of the header. columnIndex is -1 for COUNT(*)
+struct Aggregate
+{
+    AggregateFunction function;
+    int columnIndex;
+    ColumnType type;
+    std::string_view name;
+};
+
+// How the quotes of the CSV are handled
+enum class QuoteMode
+{
+    None,       // Quotes are ordinary characters (the default)
+    Permissive, // RFC 4180 quoted fields. Malformed quotes are accepted and follow the quote parity
+    Strict      // RFC 4180 quoted fields. A malformed quoted field is an error
+};
+
+// Everything needed to process the rows of a CSV: the selected columns (sorted by index) and the filters.
+// In aggregation mode the selected columns are the columns the rows are grouped by
+struct QueryPlan
+{
+    std::pmr::vector<HeaderColumn> headerColumnsToSelect;
+    FilterPlan filters;
+    std::pmr::vector<Aggregate> aggregates; // Empty unless the query is in aggregation mode
+    size_t fieldsNeeded = 0; // Fields of a row used by the selected columns and the filters (the last index used + 1)
+    QuoteMode quoteMode = QuoteMode::None;
+
+    explicit QueryPlan(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : headerColumnsToSelect(resource), filters(resource), aggregates(resource) {}
+};
+
+// Statistics of the last run of a query
+struct QueryStats
+{
+    size_t blocksScanned = 0; // Blocks of the zone map that were processed
+    size_t blocksSkipped = 0; // Blocks of the zone map that couldn't satisfy the filters
+};
+
+// Query parsed from the selectedColumns and the rowFilterDefinitions. It doesn't depend on the CSV data,
+// so it can be prepared once and run on many inputs. The plan is bound to the header of the last input
+// and it's only built again when an input has a different header.
+// The parsed state lives in arena and the plan in planArena, which is released every time the plan is built again.
+// A transient query (e.g. the one of a processCsv call) is only used for one call on one thread: its arena starts
+// with the block of the thread, and its plan is built in the same arena, since it's bound only once
+struct CsvQuery
+{
+    explicit CsvQuery(bool transient = false)
+        : arena(transient), transient(transient), selectedColumns(&arena), filterDefinitions(&arena), columnTypes(&arena),
+          aggregateDefinitions(&arena), plan(&planStorage()) {}
+
+    CsvQuery(const CsvQuery&) = delete;
+    CsvQuery& operator=(const CsvQuery&) = delete;
+
+    // Arena where the plan is built
+    QueryArena& planStorage() { return transient ? arena : planArena; }
+
+    QueryArena arena;
+    QueryArena planArena;
+    bool transient;
+
+    bool selectAllColumns = true;                                     // selectedColumns was empty
+    std::pmr::vector<std::string_view> selectedColumns;
+    std::pmr::vector<FilterDefinition> filterDefinitions;
+    QuoteMode quoteMode = QuoteMode::None;
+    std::pmr::vector<std::pair<std::string_view, ColumnType>> columnTypes; // Types set by the caller, by column name
+    bool inferTypes = false;                                          // Infer the type of the other filtered columns
+    std::pmr::vector<AggregateDefinition> aggregateDefinitions;       // Aggregation mode, grouping by the selected columns
+    size_t offset = 0;                                                // Matching rows (or groups) skipped before the output
+    size_t limit = SIZE_MAX;                                          // Matching rows (or groups) written at most
+
+    bool bound = false;
+    std::string_view boundHeader; // Copied in the arena of the plan
+    QueryPlan plan;
+
+    QueryStats stats;
+};
+
+// Convert the comparator of a filter definition. Returns false if it isn't a valid comparator
+bool parseComparator(std::string_view text, Comparator& comparator);
+
+// Parse the rowFilterDefinitions (one filter per line) in the arena. It throws a runtime_error if there's an invalid filter
+std::pmr::vector<FilterDefinition> parseFilterDefinitions(std::string_view rowFilterDefinitions, QueryArena& arena);
+
+// Parse the aggregates of the aggregation mode in the arena, separated by commas: COUNT(*), COUNT(column), SUM(column),
+// MIN(column), MAX(column) or AVG(column). The function names are case insensitive. It throws a runtime_error if there's an invalid aggregate
+std::pmr::vector<AggregateDefinition> parseAggregateDefinitions(std::string_view aggregates, QueryArena& arena);
+
+// Preprocess the filters based on the header columns and compile them in a FilterPlan, allocated in the resource.
+// columnTypes has the type of each column (by index), and the columns without a type are compared as text.
+// It throws a runtime_error if a filter has a non-existent column or a value that isn't of the type of its column
+FilterPlan preprocessFilters(const std::pmr::vector<std::string_view>& headerColumns,
+                             const std::pmr::vector<FilterDefinition>& filterDefinitions,
+                             const std::pmr::vector<ColumnType>& columnTypes, std::pmr::memory_resource* resource);
+
+// Parse the selectedColumns and the rowFilterDefinitions in the arena of the query.
+// It throws a runtime_error if there's an invalid filter
+void parseQuery(CsvQuery& query, const char selectedColumns[], const char rowFilterDefinitions[]);
+
+// Returns the plan of the query for a CSV with the header line, building it only if the header changed since the last call.
+// With quoting, the header names are compared without their quotes but written as they are in the header line.
+// sample has the first rows after the header, used to infer the column types if query.inferTypes is set
+// (the types are inferred once, when the plan is built).
+// It throws a runtime_error if a selected column or a filter column doesn't exist
+const QueryPlan& bindQuery(CsvQuery& query, std::string_view headerColumnsLine, std::string_view sample = {});
+
+// Compare two values of a typed column
+template <typename Value>
+inline bool compareValues(Value field, Value value, Comparator comparator) {
+    switch (comparator) {
+        case Comparator::Greater:
+            return field > value;
+        case Comparator::Less:
+            return field < value;
+        case Comparator::Equal:
+            return field == value;
+        case Comparator::NotEqual:
+            return field != value;
+        case Comparator::GreaterEqual:
+            return field >= value;
+        case Comparator::LessEqual:
+            return field <= value;
+    }
+    return false;
+}
+
+// Check if the field satisfies the filter of a typed column. A field that isn't of the type of the column
+// (including an empty one) doesn't satisfy any filter
+inline bool satisfiesTypedFilter(std::string_view field, const Filter& filter) {
+    int64_t integerValue;
+    double floatValue;
+    switch (filter.type) {
+        case ColumnType::Integer:
+            return parseIntegerField(field, integerValue) && compareValues(integerValue, filter.integerValue, filter.comparator);
+        case ColumnType::Float:
+            return parseFloatField(field, floatValue) && compareValues(floatValue, filter.floatValue, filter.comparator);
+        case ColumnType::Date:
+            return parseDateField(field, integerValue) && compareValues(integerValue, filter.integerValue, filter.comparator);
+        default:
+            return false;
+    }
+}
+
+// Check if the field satisfies the filter, using a lexicographical comparison (the same order as std::strcmp)
+// unless the column has a type
+inline bool satisfiesFilter(std::string_view field, const Filter& filter) {
+    if (filter.type != ColumnType::Text) {
+        return satisfiesTypedFilter(field, filter);
+    }
+
+    std::string_view value = filter.value;
+    switch (filter.comparator) {
+        case Comparator::Greater:
+            return field.compare(value) > 0;
+        case Comparator::Less:
+            return field.compare(value) < 0;
+        case Comparator::Equal:
+            return field == value; // Fields with a different size are discarded without comparing the bytes
+        case Comparator::NotEqual:
+            return field != value;
+        case Comparator::GreaterEqual:
+            return field.compare(value) >= 0;
+        case Comparator::LessEqual:
+            return field.compare(value) <= 0;
+    }
+    return false;
+}
+
+// Check if the field satisfies the group, that is any of its filters. The remaining filters are skipped once one is satisfied
+inline bool satisfiesGroup(std::string_view field, const FilterPlan& plan, const FilterGroup& group) {
+    for (int i = group.begin; i < group.end; ++i) {
+        if (satisfiesFilter(field, plan.filters[i])) return true;
+    }
+    return false;
+}
+
+// Check if the row satisfies the filters, where fieldAt(columnIndex) returns the value of a field of the row.
+// A group (column) is satisfied if any of its filters is satisfied, and the row satisfies the filters if all groups do.
+// The groups were resolved by preprocessFilters, so no state is kept per row, and the row is discarded
+// at the first group that isn't satisfied.
+// Each field is only used by its group, so fieldAt may return a view that is overwritten by the next call
+template <typename FieldAt>
+inline bool satisfiesFilters(const FilterPlan& plan, FieldAt&& fieldAt) {
+    for (const FilterGroup& group : plan.groups) {
+        if (!satisfiesGroup(fieldAt(group.columnIndex), plan, group)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Result of a filter group for each distinct value of a dictionary encoded column, one bit per code
+struct CodeBitmap
+{
+    std::vector<uint64_t> bits;
+    bool any = false; // Some code satisfies the group
+    bool all = true;  // Every code satisfies the group
+
+    bool test(uint32_t code) const { return (bits[code >> 6] >> (code & 63)) & 1; }
+};
+
+// Evaluate the group once for each of the entryCount distinct values of a column, where entryAt(code) returns the
+// value of a code. A row of the column then satisfies the group if the bit of its code is set, so the filters
+// are never evaluated per row. Like fieldAt, entryAt may return a view that is overwritten by the next call
+template <typename EntryAt>
+inline CodeBitmap evaluateGroupOnCodes(const FilterPlan& plan, const FilterGroup& group, size_t entryCount, EntryAt&& entryAt) {
+    CodeBitmap bitmap;
+    bitmap.bits.assign((entryCount + 63) / 64, 0);
+    for (size_t code = 0; code < entryCount; ++code) {
+        bool satisfied = satisfiesGroup(entryAt(code), plan, group);
+        bitmap.bits[code >> 6] |= static_cast<uint64_t>(satisfied) << (code & 63);
+        bitmap.any = bitmap.any || satisfied;
+        bitmap.all = bitmap.all && satisfied;
+    }
+    return bitmap;
+}
+
+// Returns the field of the row at columnIndex. Missing fields are treated as empty
+inline std::string_view fieldAt(const std::vector<std::string_view>& row, int columnIndex) {
+    return static_cast<size_t>(columnIndex) < row.size() ? row[columnIndex] : std::string_view();
+}
+
+// Check if the row satisfies the filters, comparing the fields as they are
+inline bool satisfiesFilters(const std::vector<std::string_view>& row, const FilterPlan& plan) {
+    return satisfiesFilters(plan, [&](int columnIndex) { return fieldAt(row, columnIndex); });
+}
+
+#endif
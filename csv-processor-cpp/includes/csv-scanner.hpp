@@ -0,0 +1,208 @@
+#ifndef CSV_SCANNER_HPP
+#define CSV_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Number of bytes classified by each call of a ScanBlockFunction
+constexpr size_t kScanBlockSize = 64;
+
+// Bitmasks of the structural characters found in a block of kScanBlockSize bytes.
+// The bit i of each mask refers to the byte i of the block
+struct BlockMasks
+{
+    uint64_t commas;
+    uint64_t newlines;
+    uint64_t quotes;
+    uint64_t quoteRegions; // Prefix XOR of quotes: the bit i is set if there's an odd number of quotes in the bytes [0, i]
+};
+
+// Classify the kScanBlockSize bytes starting at block
+using ScanBlockFunction = BlockMasks (*)(const char* block);
+
+// Instruction sets that can be used to scan the CSV data, from the slowest to the fastest
+enum class ScanLevel
+{
+    Scalar,
+    Sse2,
+    Avx2,
+    Avx512
+};
+
+// Converts the name of a level ("scalar", "sse2", "avx2" or "avx512"). Returns false if the name is unknown
+bool parseScanLevel(const char name[], ScanLevel& level);
+
+// Returns true if the CPU running the code supports the level
+bool isScanLevelSupported(ScanLevel level);
+
+// Returns the scanner currently selected. On the first call it picks the fastest level supported by the CPU,
+// unless the CSV_PROCESSOR_SIMD environment variable asks for another one
+ScanBlockFunction getScanBlockFunction();
+
+// Selects the scanner used from now on. Returns false (and keeps the current one) if the CPU doesn't support it
+bool setScanLevel(ScanLevel level);
+
+// Goes back to the scanner picked on the first call of getScanBlockFunction
+void resetScanLevel();
+
+// Classify the block starting at block. If the input ends before the block does, the bytes that exist
+// are copied to a zeroed buffer, so we never read past the end of the input
+inline BlockMasks scanBlockWithin(ScanBlockFunction scanBlock, const char* block, const char* end) {
+    if (static_cast<size_t>(end - block) >= kScanBlockSize) {
+        return scanBlock(block);
+    }
+    alignas(64) char tail[kScanBlockSize] = {};
+    std::memcpy(tail, block, end - block);
+    return scanBlock(tail);
+}
+
+// Clear the commas and newlines of the block that are inside a quoted field (RFC 4180), so they are part of the field.
+// insideQuotes has all bits set if the previous block ended inside a quoted field, and it's updated for the next one.
+// An escaped quote ("") closes and opens the quoted field again, so the bytes after it are still inside
+inline void maskQuotedCharacters(BlockMasks& masks, uint64_t& insideQuotes) {
+    uint64_t inside = masks.quoteRegions ^ insideQuotes;
+    insideQuotes = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    masks.commas &= ~inside;
+    masks.newlines &= ~inside;
+}
+
+// Call onRow(fields) for a row of forEachRow. Returns false if onRow returns false to stop the walk
+template <typename OnRow>
+inline bool visitRow(OnRow& onRow, const std::vector<std::string_view>& fields) {
+    if constexpr (std::is_same<decltype(onRow(fields)), bool>::value) {
+        return onRow(fields);
+    } else {
+        onRow(fields);
+        return true;
+    }
+}
+
+// Walk through the rows in [begin, end), calling onRow(fields) for each one with a view of the first maxFields fields of the row.
+// Rows end at '\n' and fields at ','. The last row of the range doesn't need to end with '\n'.
+// The block scanner finds every ',' and '\n' of kScanBlockSize bytes at once, so the loop only visits
+// the structural characters instead of every byte. Once a row has maxFields fields, its remaining commas
+// are skipped and the loop jumps to the next newline. The fields vector is reused between rows.
+// If quoted is true the range must start outside a quoted field, and the commas and newlines inside quoted fields
+// are ignored. The fields keep their quotes (see unquoteField). Returns true if the range ends inside a quoted field.
+// onRow may return a bool: the walk stops as soon as it returns false, and then forEachRow returns false
+template <typename OnRow>
+bool forEachRow(const char* begin, const char* end, size_t maxFields, bool quoted, std::vector<std::string_view>& fields, OnRow&& onRow) {
+    ScanBlockFunction scanBlock = getScanBlockFunction();
+
+    fields.clear();
+    const char* fieldStart = begin;
+    bool skippingFields = maxFields == 0; // The row already has all the fields needed
+    uint64_t insideQuotes = 0;
+    for (const char* block = begin; block < end; block += kScanBlockSize) {
+        BlockMasks masks = scanBlockWithin(scanBlock, block, end);
+        if (quoted) maskQuotedCharacters(masks, insideQuotes);
+
+        uint64_t structural = skippingFields ? masks.newlines : masks.commas | masks.newlines;
+        while (structural != 0) {
+            unsigned bit = __builtin_ctzll(structural);
+            const char* position = block + bit;
+            structural &= structural - 1; // Clearing the lowest bit
+
+            if (!skippingFields) {
+                fields.emplace_back(fieldStart, position - fieldStart);
+            }
+            fieldStart = position + 1;
+
+            if ((masks.newlines >> bit) & 1) {
+                if (!visitRow(onRow, fields)) {
+                    fields.clear();
+                    return false;
+                }
+                fields.clear();
+                if (skippingFields && maxFields > 0) {
+                    // The next row starts after the newline, so the commas after it count again
+                    skippingFields = false;
+                    structural |= masks.commas & ~((2ULL << bit) - 1);
+                }
+            } else if (fields.size() == maxFields) {
+                skippingFields = true;
+                structural &= masks.newlines;
+            }
+        }
+    }
+
+    // The last row, if the range doesn't end with '\n'
+    if (fieldStart < end || !fields.empty()) {
+        if (!skippingFields) fields.emplace_back(fieldStart, end - fieldStart);
+        bool keepWalking = visitRow(onRow, fields);
+        fields.clear();
+        if (!keepWalking) return false;
+    }
+    return insideQuotes != 0;
+}
+
+// Call onRowEnd(position) with the position right after every '\n' in [begin, end), without splitting the fields.
+// If quoted is true the range must start outside a quoted field, and the newlines inside quoted fields are skipped
+template <typename OnRowEnd>
+void forEachRowEnd(const char* begin, const char* end, bool quoted, OnRowEnd&& onRowEnd) {
+    ScanBlockFunction scanBlock = getScanBlockFunction();
+    uint64_t insideQuotes = 0;
+    for (const char* block = begin; block < end; block += kScanBlockSize) {
+        BlockMasks masks = scanBlockWithin(scanBlock, block, end);
+        if (quoted) maskQuotedCharacters(masks, insideQuotes);
+        for (uint64_t newlines = masks.newlines; newlines != 0; newlines &= newlines - 1) {
+            onRowEnd(block + __builtin_ctzll(newlines) + 1);
+        }
+    }
+}
+
+// Returns the position right after the first '\n' in [from, end), or end if there's none. If quoted is true,
+// the newlines inside quoted fields are skipped, and begin must be the start of a row at or before from
+const char* findRowEnd(const char* begin, const char* from, const char* end, bool quoted);
+
+// Returns the position right after the last '\n' in [begin, end), or begin if there's none.
+// If quoted is true, begin must be the start of a row and the newlines inside quoted fields are skipped
+const char* findLastRowEnd(const char* begin, const char* end, bool quoted);
+
+// Returns the value of a field as written by forEachRow with quoted = true: without the enclosing quotes and
+// with every escaped quote ("") turned into a single one. Only the fields with escaped quotes are copied (into scratch)
+inline std::string_view unquoteField(std::string_view field, std::string& scratch) {
+    if (field.empty() || field.front() != '"') {
+        return field;
+    }
+
+    // A field that isn't closed (only possible at the end of the input) keeps everything after the opening quote
+    std::string_view value = field.substr(1, field.size() >= 2 && field.back() == '"' ? field.size() - 2 : field.size() - 1);
+    size_t quote = value.find('"');
+    if (quote == std::string_view::npos) {
+        return value;
+    }
+
+    scratch.assign(value.data(), quote);
+    for (size_t i = quote; i < value.size(); ++i) {
+        scratch.push_back(value[i]);
+        if (value[i] == '"' && i + 1 < value.size() && value[i + 1] == '"') ++i;
+    }
+    return scratch;
+}
+
+// Check if the field follows RFC 4180: it has no quotes, or it's enclosed in quotes and every quote inside is escaped ("")
+inline bool isValidQuotedField(std::string_view field) {
+    if (field.find('"') == std::string_view::npos) {
+        return true;
+    }
+    if (field.size() < 2 || field.front() != '"' || field.back() != '"') {
+        return false;
+    }
+    for (size_t i = 1; i + 1 < field.size(); ++i) {
+        if (field[i] != '"') continue;
+        if (i + 2 < field.size() && field[i + 1] == '"') {
+            ++i;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
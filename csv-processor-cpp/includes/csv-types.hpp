@@ -0,0 +1,54 @@
+#ifndef CSV_TYPES_HPP
+#define CSV_TYPES_HPP
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Type used to compare the fields of a column with the values of the filters.
+// Text is the lexicographical comparison used by default
+enum class ColumnType
+{
+    Text,
+    Integer, // 64 bits signed integer
+    Float,   // Double precision floating point
+    Date     // ISO 8601 date or timestamp, e.g. 2026-01-31, 2026-01-31T10:20:30.5Z or 2026-01-31 10:20+02:00
+};
+
+// Remove a leading '+', which from_chars doesn't accept. It's kept when it's followed by another sign
+// (or by nothing), so "+-5" and "+" still fail to parse
+inline void removePlusSign(std::string_view& field) {
+    if (field.size() > 1 && field[0] == '+' && field[1] != '+' && field[1] != '-') field.remove_prefix(1);
+}
+
+// Parse the whole field as an integer. Returns false if it isn't one (or it doesn't fit in 64 bits)
+inline bool parseIntegerField(std::string_view field, int64_t& value) {
+    removePlusSign(field);
+    const char* end = field.data() + field.size();
+    std::from_chars_result result = std::from_chars(field.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end && !field.empty();
+}
+
+// Parse the whole field as a floating point number, in decimal or exponent notation. Returns false if it isn't one.
+// inf and nan aren't numbers here: from_chars accepts them, but they're more likely text in a CSV
+inline bool parseFloatField(std::string_view field, double& value) {
+    removePlusSign(field);
+    size_t digit = !field.empty() && field.front() == '-' ? 1 : 0;
+    if (digit < field.size() && !std::isdigit(static_cast<unsigned char>(field[digit])) && field[digit] != '.') return false;
+    const char* end = field.data() + field.size();
+    std::from_chars_result result = std::from_chars(field.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end && !field.empty();
+}
+
+// Parse the whole field as an ISO 8601 date or timestamp, converted to microseconds since 1970-01-01T00:00:00Z.
+// A date without time is the start of the day, and a timestamp without offset is in UTC. Returns false if it isn't one
+bool parseDateField(std::string_view field, int64_t& value);
+
+// Returns the most specific type (Integer, then Float, then Date) that every non-empty value of the sample has.
+// Returns Text if there's no such type or no non-empty value
+ColumnType inferColumnType(const std::vector<std::string_view>& sample);
+
+#endif
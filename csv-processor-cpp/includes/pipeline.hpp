@@ -0,0 +1,101 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "spsc-ring.hpp"
+
+// Buffers in flight between two stages of the pipeline. It bounds the memory used by a run,
+// and it's enough to keep both stages busy when they take about the same time per buffer
+constexpr size_t kPipelineDepth = 2;
+
+// A read of the input failed before the input was over (e.g. EIO). Unlike the end of the input, it ends the run with an error
+struct ReadError : std::runtime_error
+{
+    explicit ReadError(int error) : std::runtime_error("Error reading the CSV file: " + std::string(std::strerror(error))) {}
+};
+
+// Read stage of the pipeline: reads a file descriptor in its own thread, ahead of the rows being processed.
+// Every chunk ends at the end of a row (the row crossing the end of a read is moved to the next chunk),
+// so each one can be processed on its own. The chunks are recycled once processed, so at most readAhead + 1
+// chunks of chunkSize bytes are in memory. If a single row is bigger than a chunk, its chunk grows to fit it
+class ChunkReader
+{
+public:
+    // pending has the bytes already read from the file descriptor (starting at a row), which go first.
+    // readAhead (at most kPipelineDepth) is how many chunks are read ahead of the one being processed: a run that
+    // may stop early reads only one, so little of the input is read after it stops.
+    // The file descriptor isn't read again by anyone else until the reader is destroyed
+    ChunkReader(int fd, size_t chunkSize, bool quoted, std::string_view pending, size_t readAhead = kPipelineDepth);
+
+    // Stops the reading (even if the input isn't over) and waits for the thread
+    ~ChunkReader();
+
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    // Get the next chunk of complete rows, which stays valid until the next call.
+    // Returns false once the input is over (the last chunk may end without a '\n').
+    // Throws a ReadError if a read failed, once the chunks read before it were returned
+    bool next(std::string_view& chunk);
+
+private:
+    struct Chunk
+    {
+        std::vector<char> data;
+        size_t size = 0;   // Bytes of complete rows at the start of data
+        bool last = false; // The input is over after this chunk
+        int error = 0;     // The errno of the read that failed after this chunk, if any. Only set on the last chunk
+    };
+
+    void readLoop(std::string carry);
+    bool readInto(Chunk& chunk, size_t& filled);
+
+    int fd;
+    size_t chunkSize;
+    bool quoted;
+    size_t readAhead;
+
+    SpscRing<Chunk> filled{kPipelineDepth}; // Reader -> processing
+    SpscRing<Chunk> free{kPipelineDepth};   // Processing -> reader, to reuse their memory
+    Chunk current;                          // Chunk returned by the last call to next
+    bool finished = false;
+    std::atomic<bool> cancelled{false};
+    std::thread thread;
+};
+
+// Write stage of the pipeline: writes the output of a run in its own thread, in the order it was queued,
+// so the rows are processed while the previous output is still being written. The buffers written are given back
+// to be filled again. At most kPipelineDepth buffers wait to be written, and queuing more waits for the thread
+class OutputWriter
+{
+public:
+    explicit OutputWriter(std::function<void(const char*, size_t)> writeData);
+
+    // Writes every buffer still queued and waits for the thread
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Queue the data to be written. data is replaced by an empty buffer, one already written if there's any
+    void write(std::string& data);
+
+private:
+    void writeLoop();
+
+    std::function<void(const char*, size_t)> writeData;
+    SpscRing<std::string> pending{kPipelineDepth}; // Run -> writer
+    SpscRing<std::string> written{kPipelineDepth}; // Writer -> run, to reuse their memory
+    std::atomic<bool> closing{false};
+    std::thread thread;
+};
+
+#endif
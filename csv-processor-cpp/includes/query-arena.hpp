@@ -0,0 +1,64 @@
+#ifndef QUERY_ARENA_HPP
+#define QUERY_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+
+// Size of the block each thread keeps for the arenas of its transient queries. It fits the state of a typical query,
+// so a call like processCsv doesn't allocate from the heap at all
+constexpr size_t kThreadArenaBlockSize = 64 << 10;
+
+// First block an arena takes from the heap. Every block after it is twice as big as the previous one
+constexpr size_t kFirstArenaBlockSize = 4 << 10;
+
+// Monotonic arena for the parsed state and the plan of a query (see CsvQuery). Allocating is moving a pointer,
+// deallocating does nothing, and everything is released at once by release (or by the destructor), so the many
+// small allocations of a query never reach malloc, which contends between threads under concurrent load.
+// An arena built with useThreadBlock starts with the block of its thread (unless another arena of the thread has it),
+// so it must be released on the thread that built it. The next blocks come from the heap.
+// With CSV_DEBUG_STATS defined, the arena counts its allocations and the blocks it took from the heap
+class QueryArena : public std::pmr::memory_resource
+{
+public:
+    explicit QueryArena(bool useThreadBlock = false) : useThreadBlock(useThreadBlock) {}
+    ~QueryArena() override { release(); }
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    // Release every allocation at once. The containers in the arena must have been emptied (or destroyed) before
+    void release();
+
+    // Copy the text in the arena
+    std::string_view copy(std::string_view text);
+
+    size_t allocationCount() const { return allocations; }
+    size_t heapBlockCount() const { return heapBlocks; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    // Header of a block taken from the heap. The blocks are chained, so releasing them doesn't need a container
+    struct HeapBlock
+    {
+        HeapBlock* previous;
+    };
+
+    void* allocateInNewBlock(size_t bytes, size_t alignment);
+
+    bool useThreadBlock;
+    bool hasThreadBlock = false;
+    char* cursor = nullptr;
+    char* end = nullptr;
+    HeapBlock* lastBlock = nullptr;
+    size_t nextBlockSize = kFirstArenaBlockSize;
+    size_t allocations = 0;
+    size_t heapBlocks = 0;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ROW_INDEX_HPP
+#define ROW_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// Rows between two entries of a row index, if the caller doesn't choose
+constexpr size_t kDefaultRowsPerEntry = 1024;
+
+// Offsets of the rows of a CSV file, stored next to it in a sidecar file (see rowIndexPath).
+// Only one row every rowsPerEntry has an entry, so the index stays small, and the rows in between
+// are found by scanning from the closest entry
+struct RowIndex
+{
+    uint64_t rowsPerEntry = kDefaultRowsPerEntry;
+    uint64_t rowCount = 0;          // Rows after the header
+    bool quoted = false;            // The rows were split with RFC 4180 quoting (newlines inside quotes don't end a row)
+    std::vector<uint64_t> offsets;  // Offset in the file of the rows 0, rowsPerEntry, 2 * rowsPerEntry, ... after the header
+};
+
+// Path of the sidecar index of a CSV file
+std::string rowIndexPath(const char csvFilePath[]);
+
+// Build the index of the CSV in [data, data + size)
+RowIndex buildRowIndex(const char* data, size_t size, size_t rowsPerEntry, bool quoted);
+
+// Write the index in the path. The size and the modification time of the CSV file and the checksum of its header
+// are stored with it, so a change of the file makes the index stale. Returns false if the file can't be written
+bool writeRowIndex(const std::string& path, const RowIndex& index, const struct stat& csvFileStat, const char* data, size_t size);
+
+// Load the index from the path. Returns false if there's no index, it's invalid, or it's stale for the CSV file
+// (described by its stat and its data)
+bool loadRowIndex(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size, RowIndex& index);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SIDECAR_HPP
+#define SIDECAR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+
+// Identifies the CSV file a sidecar file (row index, zone map) was built from. A sidecar file is stale,
+// and must be ignored, once the size, the modification time or the header of the CSV file changes
+struct SidecarStamp
+{
+    uint64_t csvSize;
+    int64_t modificationSeconds;
+    int64_t modificationNanoseconds;
+    uint64_t headerSize;      // Bytes of the CSV header, including its '\n'
+    uint64_t headerChecksum;  // FNV-1a of the CSV header
+};
+
+// Stamp of the CSV file described by its stat and its data
+SidecarStamp makeSidecarStamp(const struct stat& csvFileStat, const char* data, size_t size, bool quoted);
+
+// Check if the stamp was made from the CSV file as it's now
+bool isSidecarStampFresh(const SidecarStamp& stamp, const struct stat& csvFileStat, const char* data, size_t size);
+
+// Write the data in a temporary file and rename it to the path, so a query never reads a half written sidecar.
+// Returns false if the file can't be written
+bool writeSidecarFile(const std::string& path, const std::string& contents);
+
+// Read the whole file. Returns false if it doesn't exist or can't be read
+bool readSidecarFile(const std::string& path, std::string& contents);
+
+#endif
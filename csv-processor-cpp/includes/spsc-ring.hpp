@@ -0,0 +1,129 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Size of a cache line. The indexes of the producer and the consumer are kept in different lines,
+// so the two threads don't invalidate each other's cache on every operation
+constexpr size_t kCacheLineSize = 64;
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread.
+// The producer only writes tail and the consumer only writes head, so no locks or compare-and-swap are needed.
+// Each side keeps a copy of the other's index, and only reloads it when the ring looks full (or empty).
+// A side that waits a long time for the ring parks on it (see Backoff), and the other side wakes it up after
+// its next push or pop. The lock is only taken when a side is parked
+template <typename T>
+class SpscRing
+{
+public:
+    // The capacity is rounded up to a power of 2, so the slot of an index is a mask away
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: move the value into the ring. Returns false (leaving the value untouched) if the ring is full
+    bool tryPush(T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - headCache == slots.size()) {
+            headCache = head.load(std::memory_order_acquire);
+            if (currentTail - headCache == slots.size()) return false;
+        }
+        slots[currentTail & mask] = std::move(value);
+        tail.store(currentTail + 1);
+        notify();
+        return true;
+    }
+
+    // Consumer: move the oldest value out of the ring. Returns false if the ring is empty
+    bool tryPop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (currentHead == tailCache) return false;
+        }
+        value = std::move(slots[currentHead & mask]);
+        head.store(currentHead + 1);
+        notify();
+        return true;
+    }
+
+    // Consumer: check if there's nothing to pop
+    bool isEmpty() const { return head.load(std::memory_order_relaxed) == tail.load(); }
+
+    // Producer: check if there's no room to push
+    bool isFull() const { return tail.load(std::memory_order_relaxed) - head.load() == slots.size(); }
+
+    // Block the calling side until ready() is true. ready is checked again after every push and pop, and after wake.
+    // The indexes and sleepers are sequentially consistent, so either the side pushing (or popping) sees the sleeper,
+    // or the sleeper's ready sees the push (or the pop)
+    template <typename Ready>
+    void park(Ready&& ready) {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepers.fetch_add(1);
+        wakeUp.wait(lock, ready);
+        sleepers.fetch_sub(1);
+    }
+
+    // Wake up the side parked on the ring after changing something else it waits for (e.g. a flag to stop)
+    void wake() {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeUp.notify_all();
+    }
+
+private:
+    // Wake up the side parked on the ring after a push or a pop. The lock is only taken if a side is parked
+    void notify() {
+        if (sleepers.load() > 0) wake();
+    }
+
+    std::vector<T> slots;
+    size_t mask;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head{0}; // Next slot to pop, written by the consumer
+    size_t tailCache = 0;                                // Consumer's copy of tail
+
+    alignas(kCacheLineSize) std::atomic<size_t> tail{0}; // Next slot to push, written by the producer
+    size_t headCache = 0;                                // Producer's copy of head
+
+    alignas(kCacheLineSize) std::atomic<int> sleepers{0}; // Sides parked on the ring
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+};
+
+// Wait of a thread on a ring that is full (or empty): it spins for a moment, since the other side is usually
+// about to catch up, then gives the CPU away, and finally parks on the ring until ready() is true,
+// so a stage waiting for a long time costs nothing and wakes up as soon as the other side moves
+class Backoff
+{
+public:
+    template <typename T, typename Ready>
+    void wait(SpscRing<T>& ring, Ready&& ready) {
+        if (attempts < 64) {
+            ++attempts;
+        } else if (attempts < 128) {
+            ++attempts;
+            std::this_thread::yield();
+        } else {
+            ring.park(ready);
+        }
+    }
+
+    void reset() { attempts = 0; }
+
+private:
+    int attempts = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed group of threads used to process the chunks of a CSV in parallel.
+// The thread calling parallelFor also runs tasks, so a pool of size N creates N - 1 threads.
+// The tasks are scheduled by work stealing: each thread gets a contiguous range of tasks in its own deque and runs
+// them from the front, and a thread whose deque is empty steals half of the tasks left at the back of another one.
+// So when some tasks take much longer than others, the threads that are done take the work left instead of waiting
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads running tasks, including the caller of parallelFor
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Run task(i) for every i in [0, count) using all threads, and wait until all of them are finished.
+    // If a task throws, the other tasks still run and the exception of the first task that threw (by index, not by time)
+    // is thrown again by parallelFor, so the error reported doesn't depend on how the tasks were scheduled
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    // Tasks [begin, end) left to a thread, packed in a single atomic (begin in the high 32 bits), so the owner
+    // taking the front and the thieves taking the back only need a compare-and-swap
+    struct alignas(64) TaskDeque
+    {
+        std::atomic<uint64_t> range{0};
+    };
+
+    void workerLoop(size_t self);
+    void runTasks(size_t self);
+    bool popTask(size_t self, size_t& index);
+    bool stealTasks(size_t self, size_t& index);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<TaskDeque[]> deques; // One per thread. The caller of parallelFor is the thread 0
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+
+    const std::function<void(size_t)>* currentTask = nullptr;
+    size_t pendingTasks = 0;
+    std::exception_ptr error;  // Exception of the first task (by index) that threw in the current parallelFor
+    size_t errorIndex = 0;
+    int activeWorkers = 0;     // Workers that may still be taking tasks of the current parallelFor
+    uint64_t generation = 0;   // Incremented by every parallelFor, so the workers know there are new tasks
+    bool stopping = false;
+};
+
+// Number of threads used to process a CSV. It's the value given to setCsvThreadCount, or the
+// CSV_PROCESSOR_THREADS environment variable, or the number of cores of the machine (in this order)
+int resolveThreadCount();
+
+// Overrides the number of threads. Zero (or a negative value) goes back to the default
+void setThreadCount(int threadCount);
+
+// The pools are kept between runs, since creating and joining their threads for every query costs more than
+// processing a small input. A run takes an idle pool of threadCount threads (or creates one) and gives it back
+// when it's done, so a process running one query at a time keeps a single pool, and concurrent runs get one each.
+// The idle pools of another size are destroyed, so the pool follows setThreadCount and CSV_PROCESSOR_THREADS
+std::unique_ptr<ThreadPool> acquireThreadPool(int threadCount);
+void releaseThreadPool(std::unique_ptr<ThreadPool> pool);
+
+#endif
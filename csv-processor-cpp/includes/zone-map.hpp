@@ -0,0 +1,49 @@
+#ifndef ZONE_MAP_HPP
+#define ZONE_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "csv-query.hpp"
+
+// Rows of each block of a zone map, if the caller doesn't choose
+constexpr size_t kDefaultRowsPerBlock = 4096;
+
+// Statistics of a block of consecutive rows: the smallest and the largest value (lexicographically) of each column.
+// Missing fields count as empty values, and with quoting the values are compared without their quotes
+struct ZoneMapBlock
+{
+    uint64_t offset;                     // Offset in the file of the first row of the block
+    std::vector<std::string> minimums;   // One per header column
+    std::vector<std::string> maximums;
+};
+
+// Per block statistics of a CSV file, stored next to it in a sidecar file (see zoneMapPath).
+// They allow skipping the blocks whose rows can't satisfy the filters of a query without reading them
+struct ZoneMap
+{
+    uint64_t rowsPerBlock = kDefaultRowsPerBlock;
+    bool quoted = false;              // The rows were split with RFC 4180 quoting
+    std::vector<ZoneMapBlock> blocks;
+};
+
+// Path of the sidecar zone map of a CSV file
+std::string zoneMapPath(const char csvFilePath[]);
+
+// Build the zone map of the CSV in [data, data + size)
+ZoneMap buildZoneMap(const char* data, size_t size, size_t rowsPerBlock, bool quoted);
+
+// Write the zone map in the path, stamped with the CSV file (see SidecarStamp). Returns false if the file can't be written
+bool writeZoneMap(const std::string& path, const ZoneMap& zoneMap, const struct stat& csvFileStat, const char* data, size_t size);
+
+// Load the zone map from the path. Returns false if there's no zone map, it's invalid, or it's stale for the CSV file
+bool loadZoneMap(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size, ZoneMap& zoneMap);
+
+// Check if a row of the block may satisfy the filters. It returns false only if, for a filtered column, no value
+// between the minimum and the maximum of the block satisfies any of the filters of the column.
+// Typed filters don't follow the lexicographical order, so they never discard a block
+bool blockMaySatisfyFilters(const ZoneMapBlock& block, const FilterPlan& plan);
+
+#endif
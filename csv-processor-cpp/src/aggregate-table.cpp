@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include "../includes/aggregate-table.hpp"
+#include "../includes/csv-scanner.hpp"
+
+// Slots of a table before its first growth
+constexpr size_t kInitialSlotCount = 64;
+
+AggregateTable::AggregateTable(const QueryPlan& plan)
+    : groupColumnCount(plan.headerColumnsToSelect.size()), aggregates(plan.aggregates.begin(), plan.aggregates.end()), quoted(plan.quoteMode != QuoteMode::None),
+      slots(kInitialSlotCount, 0) {
+    for (const HeaderColumn& headerColumn : plan.headerColumnsToSelect) {
+        columns.push_back(headerColumn.index);
+    }
+    for (const Aggregate& aggregate : aggregates) {
+        columns.push_back(aggregate.columnIndex);
+    }
+    fields.resize(columns.size());
+
+    // Without grouping columns every row is in the same group, which exists even if no row satisfies the filters
+    if (groupColumnCount == 0) {
+        findGroup(std::hash<std::string_view>()(std::string_view()), std::string_view(), std::string_view());
+    }
+}
+
+void AggregateTable::addFields() {
+    // The key has the length of each field, so the fields "a,b" + "c" and "a" + "b,c" are different keys
+    key.clear();
+    for (size_t i = 0; i < groupColumnCount; ++i) {
+        std::string_view field = quoted ? unquoteField(fields[i], unquoted) : fields[i];
+        uint32_t length = static_cast<uint32_t>(field.size());
+        key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        key.append(field);
+    }
+
+    size_t group = groups.size();
+    size_t found = findGroup(std::hash<std::string_view>()(key), key, std::string_view());
+    if (found == group) {
+        // A new group: its fields are written as they are in its first row
+        std::string& groupFields = groups[found].fields;
+        for (size_t i = 0; i < groupColumnCount; ++i) {
+            if (i > 0) groupFields.push_back(',');
+            groupFields.append(fields[i]);
+        }
+    }
+
+    AggregateState* groupStates = states.data() + found * aggregates.size();
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        update(groupStates[i], aggregates[i], fields[groupColumnCount + i]);
+    }
+}
+
+// Returns the index of the group with the key, adding it (with groupFields) if it doesn't exist
+size_t AggregateTable::findGroup(size_t hash, std::string_view groupKey, std::string_view groupFields) {
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        if (slots[slot] == 0) {
+            groups.push_back({hash, std::string(groupKey), std::string(groupFields)});
+            states.resize(states.size() + aggregates.size());
+            slots[slot] = static_cast<uint32_t>(groups.size());
+            // The table is kept at most half full, so the probe sequences stay short
+            if (groups.size() * 2 > slots.size()) grow();
+            return groups.size() - 1;
+        }
+        const Group& group = groups[slots[slot] - 1];
+        if (group.hash == hash && group.key == groupKey) {
+            return slots[slot] - 1;
+        }
+    }
+}
+
+void AggregateTable::grow() {
+    slots.assign(slots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        size_t slot = groups[i].hash & mask;
+        while (slots[slot] != 0) slot = (slot + 1) & mask;
+        slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+// Add an integer to a sum. If the sum of the integers would overflow, the integer is added to the floating point part
+static void addInteger(AggregateState& state, int64_t value) {
+    int64_t sum;
+    if (__builtin_add_overflow(state.integerSum, value, &sum)) {
+        state.floatSum += static_cast<double>(value);
+        state.integral = false;
+    } else {
+        state.integerSum = sum;
+    }
+}
+
+// Check if a value (its text for text columns, or its integerValue or floatValue) should replace the current
+// minimum or maximum
+static bool isBetter(std::string_view text, int64_t integerValue, double floatValue, const AggregateState& current,
+                     const Aggregate& aggregate) {
+    bool minimum = aggregate.function == AggregateFunction::Minimum;
+    switch (aggregate.type) {
+        case ColumnType::Integer:
+        case ColumnType::Date:
+            return minimum ? integerValue < current.integerValue : integerValue > current.integerValue;
+        case ColumnType::Float:
+            return minimum ? floatValue < current.floatValue : floatValue > current.floatValue;
+        default:
+            return minimum ? text < current.text : text > current.text;
+    }
+}
+
+void AggregateTable::update(AggregateState& state, const Aggregate& aggregate, std::string_view raw) {
+    std::string_view value = quoted ? unquoteField(raw, unquoted) : raw;
+    int64_t integerValue;
+    double floatValue;
+    switch (aggregate.function) {
+        case AggregateFunction::Count:
+            state.count += aggregate.columnIndex < 0 || !value.empty();
+            break;
+        case AggregateFunction::Sum:
+        case AggregateFunction::Average:
+            // The values that aren't numbers are ignored
+            if (parseIntegerField(value, integerValue)) {
+                addInteger(state, integerValue);
+                ++state.count;
+            } else if (parseFloatField(value, floatValue)) {
+                state.floatSum += floatValue;
+                state.integral = false;
+                ++state.count;
+            }
+            break;
+        case AggregateFunction::Minimum:
+        case AggregateFunction::Maximum: {
+            // The empty values and the values that aren't of the type of the column are ignored
+            int64_t candidateInteger = 0;
+            double candidateFloat = 0;
+            bool valid = !value.empty();
+            if (aggregate.type == ColumnType::Integer) {
+                valid = parseIntegerField(value, candidateInteger);
+            } else if (aggregate.type == ColumnType::Date) {
+                valid = parseDateField(value, candidateInteger);
+            } else if (aggregate.type == ColumnType::Float) {
+                valid = parseFloatField(value, candidateFloat);
+            }
+            if (valid && (state.count == 0 || isBetter(value, candidateInteger, candidateFloat, state, aggregate))) {
+                state.raw.assign(raw);
+                if (aggregate.type == ColumnType::Text) state.text.assign(value);
+                state.integerValue = candidateInteger;
+                state.floatValue = candidateFloat;
+            }
+            state.count += valid;
+            break;
+        }
+    }
+}
+
+void AggregateTable::combine(AggregateState& state, const Aggregate& aggregate, const AggregateState& other) {
+    switch (aggregate.function) {
+        case AggregateFunction::Count:
+            break;
+        case AggregateFunction::Sum:
+        case AggregateFunction::Average:
+            addInteger(state, other.integerSum);
+            state.floatSum += other.floatSum;
+            state.integral = state.integral && other.integral;
+            break;
+        case AggregateFunction::Minimum:
+        case AggregateFunction::Maximum:
+            if (other.count > 0 && (state.count == 0 || isBetter(other.text, other.integerValue, other.floatValue, state, aggregate))) {
+                state.raw = other.raw;
+                state.text = other.text;
+                state.integerValue = other.integerValue;
+                state.floatValue = other.floatValue;
+            }
+            break;
+    }
+    state.count += other.count;
+}
+
+void AggregateTable::merge(const AggregateTable& other) {
+    for (size_t i = 0; i < other.groups.size(); ++i) {
+        const Group& group = other.groups[i];
+        size_t found = findGroup(group.hash, group.key, group.fields);
+        for (size_t j = 0; j < aggregates.size(); ++j) {
+            combine(states[found * aggregates.size() + j], aggregates[j], other.states[i * aggregates.size() + j]);
+        }
+    }
+}
+
+// Append a number in its shortest form that reads back as the same number
+template <typename Number>
+static void appendNumber(std::string& output, Number number) {
+    char digits[64];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), number);
+    output.append(digits, result.ptr);
+}
+
+void AggregateTable::write(std::string& output, size_t offset, size_t limit) const {
+    size_t end = offset + std::min(limit, groups.size() - std::min(offset, groups.size()));
+    for (size_t i = offset; i < end; ++i) {
+        output.append(groups[i].fields);
+        for (size_t j = 0; j < aggregates.size(); ++j) {
+            if (groupColumnCount > 0 || j > 0) output.push_back(',');
+
+            // The aggregates without values (besides COUNT) are written as empty fields
+            const AggregateState& state = states[i * aggregates.size() + j];
+            switch (aggregates[j].function) {
+                case AggregateFunction::Count:
+                    appendNumber(output, state.count);
+                    break;
+                case AggregateFunction::Sum:
+                    if (state.count > 0 && state.integral) {
+                        appendNumber(output, state.integerSum);
+                    } else if (state.count > 0) {
+                        appendNumber(output, static_cast<double>(state.integerSum) + state.floatSum);
+                    }
+                    break;
+                case AggregateFunction::Average:
+                    if (state.count > 0) {
+                        appendNumber(output, (static_cast<double>(state.integerSum) + state.floatSum) / state.count);
+                    }
+                    break;
+                case AggregateFunction::Minimum:
+                case AggregateFunction::Maximum:
+                    output.append(state.raw);
+                    break;
+            }
+        }
+        output.push_back('\n');
+    }
+}
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../includes/columnar-cache.hpp"
+#include "../includes/csv-query.hpp"
+#include "../includes/csv-scanner.hpp"
+#include "../includes/sidecar.hpp"
+
+// Identifies the columnar cache files and the version of their format
+static const char kColumnarCacheMagic[8] = {'C', 'S', 'V', 'C', 'O', 'L', 'S', '1'};
+
+// Header of the columnar cache file. It's followed by one ColumnDescriptor per column and the data of the columns
+struct ColumnarFileHeader
+{
+    char magic[8];
+    SidecarStamp stamp;
+    uint64_t quoted;
+    uint64_t unterminated;  // With quoting, the CSV ends inside a quoted field
+    uint64_t rowCount;
+    uint64_t columnCount;
+};
+
+// Where the data of a column is in the file. The positions are relative to the start of the file
+struct ColumnDescriptor
+{
+    ColumnEncoding encoding;
+    uint64_t entryCount;       // Dictionary: number of entries
+    uint64_t offsetsPosition;  // uint64_t per value (Plain) or per entry (Dictionary)
+    uint64_t lengthsPosition;  // uint32_t per value (Plain) or per entry (Dictionary)
+    uint64_t codesPosition;    // Dictionary: uint32_t per value
+    uint64_t heapPosition;
+    uint64_t heapSize;
+};
+
+ColumnarCache::~ColumnarCache() {
+    if (mapping != nullptr) munmap(mapping, length);
+}
+
+// Check if the array of count elements of elementSize bytes at position is inside a file of fileSize bytes
+static bool isInsideFile(uint64_t position, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+    return position <= fileSize && count <= (fileSize - position) / elementSize;
+}
+
+// Check if the values [begin, end) of the offsets and lengths are inside the heap
+static bool areValuesInsideHeap(const ColumnView& column, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        if (column.offsets[i] > column.heapSize || column.lengths[i] > column.heapSize - column.offsets[i]) return false;
+    }
+    return true;
+}
+
+bool ColumnarCache::isColumnValid(size_t index, size_t beginRow, size_t endRow) const {
+    const ColumnView& column = columns[index];
+    if (column.encoding == ColumnEncoding::Plain) return areValuesInsideHeap(column, beginRow, endRow);
+    for (size_t row = beginRow; row < endRow; ++row) {
+        if (column.codes[row] >= column.entryCount) return false;
+    }
+    return areValuesInsideHeap(column, 0, column.entryCount);
+}
+
+bool ColumnarCache::open(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat cacheStat;
+    if (fstat(fd, &cacheStat) != 0 || static_cast<size_t>(cacheStat.st_size) < sizeof(ColumnarFileHeader)) {
+        close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(cacheStat.st_size);
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    mapping = address;
+    const char* file = static_cast<const char*>(mapping);
+
+    ColumnarFileHeader header;
+    std::memcpy(&header, file, sizeof(header));
+    if (std::memcmp(header.magic, kColumnarCacheMagic, sizeof(kColumnarCacheMagic)) != 0
+        || !isSidecarStampFresh(header.stamp, csvFileStat, data, size)
+        || !isInsideFile(sizeof(header), header.columnCount, sizeof(ColumnDescriptor), length)) {
+        return false;
+    }
+    quoted = header.quoted != 0;
+    unterminated = header.unterminated != 0;
+    rows = header.rowCount;
+
+    const ColumnDescriptor* descriptors = reinterpret_cast<const ColumnDescriptor*>(file + sizeof(header));
+    for (uint64_t i = 0; i < header.columnCount; ++i) {
+        const ColumnDescriptor& descriptor = descriptors[i];
+        bool dictionary = descriptor.encoding == ColumnEncoding::Dictionary;
+        uint64_t valueCount = dictionary ? descriptor.entryCount : rows;
+        if ((!dictionary && descriptor.encoding != ColumnEncoding::Plain)
+            || !isInsideFile(descriptor.offsetsPosition, valueCount, sizeof(uint64_t), length)
+            || !isInsideFile(descriptor.lengthsPosition, valueCount, sizeof(uint32_t), length)
+            || (dictionary && !isInsideFile(descriptor.codesPosition, rows, sizeof(uint32_t), length))
+            || !isInsideFile(descriptor.heapPosition, descriptor.heapSize, 1, length)) {
+            columns.clear();
+            return false;
+        }
+
+        ColumnView column;
+        column.encoding = descriptor.encoding;
+        column.offsets = reinterpret_cast<const uint64_t*>(file + descriptor.offsetsPosition);
+        column.lengths = reinterpret_cast<const uint32_t*>(file + descriptor.lengthsPosition);
+        column.codes = dictionary ? reinterpret_cast<const uint32_t*>(file + descriptor.codesPosition) : nullptr;
+        column.entryCount = dictionary ? descriptor.entryCount : 0;
+        column.heap = file + descriptor.heapPosition;
+        column.heapSize = descriptor.heapSize;
+        columns.push_back(column);
+    }
+
+    return true;
+}
+
+std::string columnarCachePath(const char csvFilePath[]) {
+    return std::string(csvFilePath) + ".col";
+}
+
+// What the first pass learns about a column
+struct ColumnSummary
+{
+    uint64_t heapSize = 0;                                  // Bytes of all the values
+    bool dictionary = false;                                // The column is still a dictionary candidate
+    std::unordered_map<std::string_view, uint32_t> codes;   // Code of each distinct value, pointing into the CSV data
+    std::vector<std::string_view> entries;                  // Distinct values, by code
+};
+
+// Round the position up to a multiple of 8 bytes, so the arrays of the file are aligned
+static uint64_t align(uint64_t position) {
+    return (position + 7) & ~static_cast<uint64_t>(7);
+}
+
+bool writeColumnarCache(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size,
+                        bool quoted, bool dictionaryEncode) {
+    const char* end = data + size;
+    const char* rowsBegin = findRowEnd(data, data, end, quoted);
+    std::vector<std::string_view> fields;
+
+    // Counting the columns of the header. Each row keeps only this number of fields
+    size_t columnCount = 0;
+    forEachRow(data, rowsBegin, SIZE_MAX, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        if (columnCount == 0) columnCount = row.size();
+    });
+    columnCount = std::max<size_t>(columnCount, 1);
+
+    // First pass: the number of rows, the size of the heaps and the distinct values of the dictionary candidates
+    std::vector<ColumnSummary> summaries(columnCount);
+    for (ColumnSummary& summary : summaries) summary.dictionary = dictionaryEncode;
+    uint64_t rowCount = 0;
+    bool valuesFit = true;
+    bool unterminated = forEachRow(rowsBegin, end, columnCount, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        ++rowCount;
+        for (size_t i = 0; i < columnCount; ++i) {
+            std::string_view value = fieldAt(row, i);
+            ColumnSummary& summary = summaries[i];
+            valuesFit = valuesFit && value.size() <= UINT32_MAX;
+            summary.heapSize += value.size();
+            if (summary.dictionary && summary.codes.emplace(value, summary.entries.size()).second) {
+                summary.entries.push_back(value);
+                if (summary.entries.size() >= kMaxDictionaryEntries) {
+                    // Too many distinct values: the column is stored as it is
+                    summary.dictionary = false;
+                    summary.codes = {};
+                    summary.entries = {};
+                }
+            }
+        }
+    });
+    if (!valuesFit) {
+        return false;
+    }
+
+    // Placing the arrays of each column after the descriptors
+    ColumnarFileHeader header = {};
+    std::memcpy(header.magic, kColumnarCacheMagic, sizeof(kColumnarCacheMagic));
+    header.stamp = makeSidecarStamp(csvFileStat, data, size, quoted);
+    header.quoted = quoted;
+    header.unterminated = unterminated;
+    header.rowCount = rowCount;
+    header.columnCount = columnCount;
+
+    std::vector<ColumnDescriptor> descriptors(columnCount);
+    uint64_t position = sizeof(header) + columnCount * sizeof(ColumnDescriptor);
+    for (size_t i = 0; i < columnCount; ++i) {
+        ColumnSummary& summary = summaries[i];
+        ColumnDescriptor& descriptor = descriptors[i];
+        uint64_t valueCount = rowCount;
+        descriptor.encoding = ColumnEncoding::Plain;
+        if (summary.dictionary) {
+            descriptor.encoding = ColumnEncoding::Dictionary;
+            descriptor.entryCount = valueCount = summary.entries.size();
+            summary.heapSize = 0;
+            for (std::string_view entry : summary.entries) summary.heapSize += entry.size();
+            descriptor.codesPosition = position = align(position);
+            position += rowCount * sizeof(uint32_t);
+        }
+        descriptor.offsetsPosition = position = align(position);
+        position += valueCount * sizeof(uint64_t);
+        descriptor.lengthsPosition = position = align(position);
+        position += valueCount * sizeof(uint32_t);
+        descriptor.heapPosition = position = align(position);
+        descriptor.heapSize = summary.heapSize;
+        position += summary.heapSize;
+    }
+    uint64_t fileSize = position;
+
+    // The file is written through a mapping of its final size, and renamed once it's complete
+    std::string temporaryPath = path + ".tmp";
+    int fd = ::open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    void* address = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(fileSize)) == 0) {
+        address = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (address == MAP_FAILED) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    char* file = static_cast<char*>(address);
+    std::memcpy(file, &header, sizeof(header));
+    std::memcpy(file + sizeof(header), descriptors.data(), columnCount * sizeof(ColumnDescriptor));
+
+    // The entries of the dictionaries are known since the first pass
+    for (size_t i = 0; i < columnCount; ++i) {
+        const ColumnDescriptor& descriptor = descriptors[i];
+        if (descriptor.encoding != ColumnEncoding::Dictionary) continue;
+        uint64_t* offsets = reinterpret_cast<uint64_t*>(file + descriptor.offsetsPosition);
+        uint32_t* lengths = reinterpret_cast<uint32_t*>(file + descriptor.lengthsPosition);
+        uint64_t heapOffset = 0;
+        for (size_t code = 0; code < summaries[i].entries.size(); ++code) {
+            std::string_view entry = summaries[i].entries[code];
+            offsets[code] = heapOffset;
+            lengths[code] = static_cast<uint32_t>(entry.size());
+            std::memcpy(file + descriptor.heapPosition + heapOffset, entry.data(), entry.size());
+            heapOffset += entry.size();
+        }
+    }
+
+    // Second pass: the values (or the codes) of every row
+    std::vector<uint64_t> heapOffsets(columnCount, 0);
+    uint64_t rowIndex = 0;
+    forEachRow(rowsBegin, end, columnCount, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        for (size_t i = 0; i < columnCount; ++i) {
+            std::string_view value = fieldAt(row, i);
+            const ColumnDescriptor& descriptor = descriptors[i];
+            if (descriptor.encoding == ColumnEncoding::Dictionary) {
+                reinterpret_cast<uint32_t*>(file + descriptor.codesPosition)[rowIndex] = summaries[i].codes.find(value)->second;
+            } else {
+                reinterpret_cast<uint64_t*>(file + descriptor.offsetsPosition)[rowIndex] = heapOffsets[i];
+                reinterpret_cast<uint32_t*>(file + descriptor.lengthsPosition)[rowIndex] = static_cast<uint32_t>(value.size());
+                std::memcpy(file + descriptor.heapPosition + heapOffsets[i], value.data(), value.size());
+                heapOffsets[i] += value.size();
+            }
+        }
+        ++rowIndex;
+    });
+
+    bool written = msync(address, fileSize, MS_SYNC) == 0;
+    munmap(address, fileSize);
+    if (!written || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -1,251 +1,1449 @@
 #include <iostream>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstring>
 #include <algorithm>
-#include <unordered_map>
 #include <stdexcept> 
-#include <fstream>
-#include <regex>
+#include <cerrno>
+#include <memory>
+#include <atomic>
+#include <cstdio>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "../includes/csv-processor.hpp"
+#include "../includes/csv-query.hpp"
+#include "../includes/csv-scanner.hpp"
+#include "../includes/thread-pool.hpp"
+#include "../includes/row-index.hpp"
+#include "../includes/zone-map.hpp"
+#include "../includes/columnar-cache.hpp"
+#include "../includes/aggregate-table.hpp"
+#include "../includes/pipeline.hpp"
 
-// Struct to store the header column name and its index
-struct HeaderColumn
+// Read-only memory mapping of a file. The parser works directly over the mapped bytes,
+// so the file is never copied into a std::string. The mapping is released when the object goes out of scope
+class MappedFile
 {
-    std::string name;
-    int index;
+public:
+    explicit MappedFile(const char path[]) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+            return;
+        }
+
+        // An empty file can't be mapped, but it's still a valid (empty) input
+        length = static_cast<size_t>(fileStat.st_size);
+        if (length == 0) {
+            mapped = true;
+            return;
+        }
+
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            length = 0;
+            return;
+        }
+        mapping = address;
+        mapped = true;
+
+        // The rows are read once from the beginning to the end, so we ask the kernel for an aggressive read-ahead
+        madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile() {
+        if (mapping != nullptr) munmap(mapping, length);
+        if (fd >= 0) close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // True if the file was opened (it may still not be mapped, e.g. pipes and other non-regular files)
+    bool isOpen() const { return fd >= 0; }
+    bool isMapped() const { return mapped; }
+    int descriptor() const { return fd; }
+    const char* data() const { return mapping != nullptr ? static_cast<const char*>(mapping) : ""; }
+    size_t size() const { return length; }
+    const struct stat& status() const { return fileStat; }
+
+private:
+    int fd = -1;
+    struct stat fileStat = {};
+    void* mapping = nullptr;
+    size_t length = 0;
+    bool mapped = false;
 };
 
-// Struct to store the filter definition
-struct Filter
+// Write the data in the sink. If a write fails, its errno is kept in sink.error and the rest of the output is dropped
+void writeToSink(CsvSink& sink, const char* data, size_t size) {
+    if (sink.error != 0) return;
+    switch (sink.type) {
+        case CSV_SINK_STDOUT:
+            std::cout.write(data, size);
+            if (!std::cout) sink.error = EIO;
+            break;
+        case CSV_SINK_BUFFER: {
+            // The output that doesn't fit in the buffer is only counted, so the caller knows the size it needs
+            size_t available = sink.size < sink.capacity ? sink.capacity - sink.size : 0;
+            std::memcpy(sink.buffer + sink.size, data, std::min(size, available));
+            sink.size += size;
+            break;
+        }
+        case CSV_SINK_FD:
+            while (size > 0) {
+                ssize_t written = write(sink.fd, data, size);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) {
+                    // A write of a non-empty block that writes nothing would be retried forever
+                    sink.error = written < 0 ? errno : EIO;
+                    break;
+                }
+                data += written;
+                size -= written;
+            }
+            break;
+        case CSV_SINK_CALLBACK:
+            sink.callback(sink.context, data, size);
+            break;
+    }
+}
+
+// Output buffer that is written to the sink whenever it grows past kOutputFlushSize, so the sink receives
+// big blocks and the memory used by the output doesn't depend on how many rows match the filters.
+// The blocks are written by an OutputWriter thread, started by the first flush, so the rows keep being processed
+// while the sink is written (and the outputs that fit in a single block never start it).
+// Without a sink the buffer only accumulates the data, which is how each thread stores the rows of its slice
+class OutputBuffer
 {
-    int columnIndex;
-    std::string comparator;
-    std::string value;
-};
+public:
+    static constexpr size_t kOutputFlushSize = 1 << 20;
+
+    explicit OutputBuffer(CsvSink* sink) : sink(sink) {
+        if (sink != nullptr) buffer.reserve(kOutputFlushSize);
+    }
+    OutputBuffer(OutputBuffer&&) = default;
 
-// Preprocess the filters based on the header columns and the rowFilterDefinitions and store them in a vector of Filters
-std::vector<Filter> preprocessFilters(const std::vector<std::string>& headerColumns, const std::string& rowFilterDefinitions){
-    // Checking if the rowFilterDefinitions is empty
-    if(rowFilterDefinitions.empty()){
-        throw std::runtime_error("Invalid filter: There is no filter, rowFilterDefinitions is empty");
-    }
-    
-    std::vector<Filter> filters;
-    std::istringstream filterStream(rowFilterDefinitions);
-    std::string filterDefinition;
-
-    while (std::getline(filterStream, filterDefinition, '\n')) {
-        // Using a regex to find the headerColumnName, the comparator and the value
-        // If we don't find any valid comparator, we throw an error
-        std::regex re(R"(([^<>=!=>=<=]+)([><=!=]{1,2})([^<>=!=>=<=]+))"); // Allows anything before and after the comparator
-        std::smatch match;
-        if (!std::regex_match(filterDefinition, match, re)) {
-            throw std::runtime_error("Invalid filter: '" + filterDefinition + "'");
-        }
-        std::string headerColumnName = match[1];
-        std::string comparator = match[2];
-        std::string value = match[3];
-        
-        // Finding the index of the headerColumnName in the headerColumns and storing the filter in the filters vector
-        auto it = std::find(headerColumns.begin(), headerColumns.end(), headerColumnName);
-        if(it != headerColumns.end()){
-            int columnIndex = std::distance(headerColumns.begin(), it);
-            filters.push_back({columnIndex, comparator, value});
+    // The writer thread (a member) is destroyed after the last block is queued, so it's written before the run returns
+    ~OutputBuffer() {
+        if (writer == nullptr && sink != nullptr && !buffer.empty()) {
+            writeToSink(*sink, buffer.data(), buffer.size());
         } else {
-            throw std::runtime_error("Header '"+headerColumnName+"' not found in CSV file/string");
-        } 
+            flush();
+        }
+    }
+
+    void append(const char* data, size_t size) { buffer.append(data, size); }
+    void append(std::string_view data) { buffer.append(data); }
+    void put(char c) { buffer.push_back(c); }
+
+    // Append the data accumulated by another buffer. Big blocks are given to the writer instead of being copied
+    void append(OutputBuffer& other) {
+        if (sink != nullptr && other.buffer.size() >= kOutputFlushSize) {
+            flush();
+            queue(other.buffer);
+        } else {
+            buffer.append(other.buffer);
+            flushIfFull();
+        }
     }
 
-    return filters;
+    // Append the bytes [begin, end) accumulated by another buffer
+    void append(const OutputBuffer& other, size_t begin, size_t end) {
+        buffer.append(other.buffer, begin, end - begin);
+        flushIfFull();
+    }
+
+    // Without a sink, the buffer keeps all the data appended
+    bool isBuffered() const { return sink == nullptr; }
+    size_t size() const { return buffer.size(); }
+
+    // Called after every row, so the buffer never goes much further than kOutputFlushSize
+    void flushIfFull() {
+        if (buffer.size() >= kOutputFlushSize) flush();
+    }
+
+    void flush() {
+        if (buffer.empty() || sink == nullptr) return;
+        queue(buffer);
+        buffer.reserve(kOutputFlushSize);
+    }
+
+private:
+    // Give the data to the writer thread, which leaves an empty buffer in its place
+    void queue(std::string& data) {
+        if (writer == nullptr) {
+            CsvSink* target = sink;
+            writer.reset(new OutputWriter([target](const char* data, size_t size) { writeToSink(*target, data, size); }));
+        }
+        writer->write(data);
+    }
+
+    CsvSink* sink;
+    std::string buffer;
+    std::unique_ptr<OutputWriter> writer;
+};
+
+// Write the selected header columns separated by commas. In aggregation mode they are followed by the names of the aggregates
+void writeHeader(const QueryPlan& plan, OutputBuffer& output) {
+    const std::pmr::vector<HeaderColumn>& headerColumnsToSelect = plan.headerColumnsToSelect;
+    for (size_t i = 0; i < headerColumnsToSelect.size(); ++i) {
+        output.append(headerColumnsToSelect[i].name);
+        if (i < headerColumnsToSelect.size() - 1) output.put(',');
+    }
+    for (size_t i = 0; i < plan.aggregates.size(); ++i) {
+        if (i > 0 || !headerColumnsToSelect.empty()) output.put(',');
+        output.append(plan.aggregates[i].name);
+    }
+    output.put('\n');
+}
+
+// Write the selected fields of the row separated by commas. Missing fields are written as empty
+void writeRow(const std::vector<std::string_view>& row, const QueryPlan& plan, OutputBuffer& output) {
+    const std::pmr::vector<HeaderColumn>& headerColumnsToSelect = plan.headerColumnsToSelect;
+    for (size_t i = 0; i < headerColumnsToSelect.size(); ++i) {
+        size_t index = headerColumnsToSelect[i].index;
+        if (index < row.size()) output.append(row[index]);
+        if (i < headerColumnsToSelect.size() - 1) output.put(',');
+    }
+    output.put('\n');
+    output.flushIfFull();
 }
 
-// Check if the row satisfies the filters. 
-// Receives a row and a vector of filters, so it iterates over the filters and checks if the row satisfies them
-bool satisfiesFilters(const std::vector<std::string>& row, const std::vector<Filter>& filters) {
-    // Map to store whether a header satisfies any of its filters
-    std::unordered_map<int, bool> headerSatisfied;
+// What a run of a query produces
+enum class RunMode
+{
+    Rows,   // The rows that satisfy the filters (or their aggregates in aggregation mode)
+    Count,  // Only the number of rows that satisfy the filters. Nothing is written
+    Exists  // Only if any row satisfies the filters. Nothing is written, and the run stops at the first one
+};
+
+// Options of a run of a query over any input
+struct RunOptions
+{
+    RunMode mode = RunMode::Rows;
+    size_t firstRow = 0;             // Rows after the header to be processed
+    size_t rowCount = SIZE_MAX;
+};
 
-    // Iterating over the filters and checking if the row satisfies them
-    for (const auto& filter : filters) {
-        int columnIndex = filter.columnIndex;
-        std::string comparator = filter.comparator;
-        std::string value = filter.value;
+// Progress of the slices of a limited run, shared by their targets. Once the slices [0, fullThrough] were processed
+// and they keep the rows the run still needs, the slices after them can't write anything, so they stop
+struct SliceProgress
+{
+    static const size_t kUnprocessed = SIZE_MAX;
 
-        // Obtaining the field of the row based on the columnIndex
-        const std::string& field = row[columnIndex];
+    size_t rowsNeeded;                              // Rows to be skipped plus rows to be written
+    std::vector<std::atomic<size_t>> sliceRows;     // Rows kept by each processed slice, or kUnprocessed
+    std::atomic<size_t> fullThrough{SIZE_MAX};
 
-        // Lexicographical comparison using std::strcmp
-        int comparison = std::strcmp(field.c_str(), value.c_str());
+    SliceProgress(size_t rowsNeeded, size_t sliceCount) : rowsNeeded(rowsNeeded), sliceRows(sliceCount) {
+        for (std::atomic<size_t>& rows : sliceRows) rows.store(kUnprocessed);
+    }
 
-        bool satisfied = false;
-        
-        // Checking if the comparison satisfies the filter
-        if (comparator == ">") {
-            satisfied = (comparison > 0);
-        } else if (comparator == "<") {
-            satisfied = (comparison < 0);
-        } else if (comparator == "=") {
-            satisfied = (comparison == 0);
-        } else if(comparator == "!="){
-            satisfied = (comparison != 0);
-        } else if(comparator == ">="){
-            satisfied = (comparison >= 0);
-        } else if(comparator == "<="){
-            satisfied = (comparison <= 0);
-        } else { // Checking again if the comparator is valid
-            throw std::runtime_error("Invalid filter: '" + field + comparator + value + "'");
+    // Record the rows kept by the slice once it's processed. If the slices before it were processed too,
+    // we can find the first one whose rows (with the ones before) are enough. Every slice that finds it finds
+    // the same one, since the rows of the slices before it don't change any more
+    void finishSlice(size_t slice, size_t rows) {
+        sliceRows[slice].store(rows);
+        size_t rowsBefore = 0;
+        for (size_t i = 0; i < sliceRows.size(); ++i) {
+            size_t rowsOfSlice = sliceRows[i].load();
+            if (rowsOfSlice == kUnprocessed) return;
+            rowsBefore += rowsOfSlice;
+            if (rowsBefore >= rowsNeeded) {
+                fullThrough.store(i);
+                return;
+            }
         }
+    }
+};
+
+// Where the rows that satisfy the filters go. They are written in the output, except in aggregation mode,
+// where they are added to the aggregates, which are only written once every row was processed,
+// and in the count and exists modes, where they are only counted.
+// With a limit (see setLimit), the first offset rows are skipped and the target is stopped after limit rows
+struct RowTarget
+{
+    OutputBuffer output;
+    std::unique_ptr<AggregateTable> aggregates;
+    RunMode mode;
+    size_t matches = 0;                         // Rows that satisfied the filters
+    std::shared_ptr<std::atomic<bool>> stopped; // Shared with the targets of the slices. Set once the run can end
+
+    // Limit of the rows written (or of the groups, in aggregation mode)
+    size_t offset = 0;                          // Rows still to be skipped
+    size_t limit = SIZE_MAX;                    // Rows still to be written
+    bool full = false;                          // The limit was reached. Unlike stopped, it only stops this target
+    std::vector<size_t> rowEnds;                // Slices of a limited run: end of each row in the output
+    std::shared_ptr<SliceProgress> progress;    // Slices of a limited run: shared with the other slices
+    size_t sliceIndex = 0;
+
+    RowTarget(const QueryPlan& plan, CsvSink* sink, RunMode mode = RunMode::Rows)
+        : output(sink), mode(mode), stopped(std::make_shared<std::atomic<bool>>(false)) {
+        if (!plan.aggregates.empty() && mode == RunMode::Rows) aggregates.reset(new AggregateTable(plan));
+    }
+
+    // Skip the first offset rows and write up to limit rows after them. The count and exists modes ignore it
+    void setLimit(size_t rowOffset, size_t rowLimit) {
+        if (mode != RunMode::Rows) return;
+        offset = rowOffset;
+        limit = rowLimit;
+        if (limit == 0 && !aggregates) stop();
+    }
+
+    bool isLimited() const { return offset > 0 || limit != SIZE_MAX; }
+
+    // The run may stop before the end of the input (a limit on the rows, or the exists mode), so the input
+    // shouldn't be read much further than the rows processed
+    bool mayStopEarly() const { return mode == RunMode::Exists || (isLimited() && !aggregates); }
+
+    // Targets of sliceCount slices processed by other threads, appended to this one afterwards in order.
+    // A slice doesn't know how many rows the slices before it have, so it keeps every row this target may still
+    // write (the rows to be skipped included), and append picks the ones after the offset. With a limit, the slices
+    // share their progress, so a slice stops once the slices before it are known to have enough rows
+    std::vector<RowTarget> slices(const QueryPlan& plan, size_t sliceCount) const {
+        std::vector<RowTarget> targets;
+        targets.reserve(sliceCount);
+        std::shared_ptr<SliceProgress> sliceProgress;
+        // Never SIZE_MAX, so the slices record where their rows end
+        size_t sliceLimit = offset < SIZE_MAX - 1 && limit < SIZE_MAX - 1 - offset ? offset + limit : SIZE_MAX - 1;
+        if (isLimited() && !aggregates) sliceProgress = std::make_shared<SliceProgress>(sliceLimit, sliceCount);
+        for (size_t i = 0; i < sliceCount; ++i) {
+            targets.emplace_back(plan, nullptr, mode);
+            RowTarget& target = targets.back();
+            target.stopped = stopped;
+            if (sliceProgress) {
+                target.limit = sliceLimit;
+                target.progress = sliceProgress;
+                target.sliceIndex = i;
+            }
+        }
+        return targets;
+    }
+
+    // Called by the thread of a slice once it's processed
+    void finishSlice() {
+        if (progress) progress->finishSlice(sliceIndex, rowEnds.size());
+    }
 
-        // If the header satisfies the filter, we store as true in the headerSatisfied map
-        if(satisfied){
-            headerSatisfied[columnIndex] = true;
+    // Check if the rows left don't need to be processed. Checked after every row, from any thread
+    bool isStopped() const {
+        return full || stopped->load(std::memory_order_relaxed)
+               || (progress && sliceIndex > progress->fullThrough.load(std::memory_order_relaxed));
+    }
+
+    // Add a row, where fieldAt(columnIndex) returns a field of the row as it is in the input
+    template <typename FieldAt, typename WriteRow>
+    void add(FieldAt&& fieldAt, WriteRow&& writeRow) {
+        ++matches;
+        if (mode == RunMode::Exists) {
+            stopped->store(true, std::memory_order_relaxed);
+        } else if (mode == RunMode::Count) {
+            return;
+        } else if (aggregates) {
+            aggregates->add(fieldAt);
+        } else if (offset > 0) {
+            --offset;
+        } else {
+            writeRow();
+            if (limit == SIZE_MAX) return;
+            if (output.isBuffered()) rowEnds.push_back(output.size());
+            if (--limit == 0) stop();
         }
     }
 
-    // Checking if all headers satisfy the filters
-    for (const auto& filter : filters) {
-        int columnIndex = filter.columnIndex;
-        // If any header doesn't satisfy the filter, we return false
-        if(!headerSatisfied[columnIndex]){
-            return false;
+    // Add count rows that satisfied the filters without their fields, which is enough in the count and exists modes
+    void addMatches(size_t count) {
+        matches += count;
+        if (mode == RunMode::Exists && count > 0) stopped->store(true, std::memory_order_relaxed);
+    }
+
+    // Append the rows of a slice processed by another thread (or merge its aggregates)
+    void append(RowTarget& slice) {
+        matches += slice.matches;
+        if (aggregates) {
+            aggregates->merge(*slice.aggregates);
+        } else if (!isLimited()) {
+            output.append(slice.output);
+        } else if (!full) {
+            size_t rowCount = slice.rowEnds.size();
+            size_t skipped = std::min(offset, rowCount);
+            size_t taken = std::min(limit, rowCount - skipped);
+            size_t begin = skipped > 0 ? slice.rowEnds[skipped - 1] : 0;
+            size_t end = skipped + taken > 0 ? slice.rowEnds[skipped + taken - 1] : 0;
+            output.append(slice.output, begin, end);
+            offset -= skipped;
+            if (limit != SIZE_MAX) limit -= taken;
+            if (limit == 0) stop();
         }
     }
 
-    return true;
+    // Write the aggregates, once every row was processed
+    void finish() {
+        if (!aggregates) return;
+        std::string groups;
+        aggregates->write(groups, offset, limit);
+        output.append(groups);
+    }
+
+private:
+    // A target with a sink writes the rows of the run, so it stops the whole run. A slice only stops itself,
+    // since the slices before it still have to find their rows
+    void stop() {
+        full = true;
+        if (!output.isBuffered()) stopped->store(true, std::memory_order_relaxed);
+    }
+};
+
+// Add a row that satisfies the filters to the target
+void addRow(const std::vector<std::string_view>& row, const QueryPlan& plan, RowTarget& target) {
+    target.add([&](int columnIndex) { return fieldAt(row, columnIndex); }, [&]() { writeRow(row, plan, target.output); });
 }
 
-void processCsv(const char csv[], const char selectedColumns[], const char rowFilterDefinitions[]) {
+// Plan used by a run in the mode. In the count and exists modes nothing is written, so the rows are only split
+// up to the last filtered column. filterPlan stores that plan
+const QueryPlan& planForMode(const QueryPlan& plan, RunMode mode, QueryPlan& filterPlan) {
+    if (mode == RunMode::Rows) {
+        return plan;
+    }
+    filterPlan.filters = plan.filters;
+    filterPlan.quoteMode = plan.quoteMode;
+    filterPlan.fieldsNeeded = 0;
+    for (const FilterGroup& group : plan.filters.groups) {
+        filterPlan.fieldsNeeded = std::max<size_t>(filterPlan.fieldsNeeded, group.columnIndex + 1);
+    }
+    return filterPlan;
+}
+
+// Process the rows in [begin, end), adding the ones that satisfy the filters to the target.
+// The range must contain only complete rows, although the last one doesn't need to end with '\n'.
+// The walk ends early once the target is stopped
+void processRows(const char* begin, const char* end, const QueryPlan& plan, RowTarget& target) {
+    // Views of the fields of the current row, reused for every row. A row never has more than fieldsNeeded views,
+    // so the vector is allocated once
+    std::vector<std::string_view> fields;
+    fields.reserve(std::max<size_t>(plan.fieldsNeeded, 1));
+
+    if (plan.quoteMode == QuoteMode::None) {
+        forEachRow(begin, end, plan.fieldsNeeded, false, fields, [&](const std::vector<std::string_view>& row) {
+            // Checking if the row satisfies the filters
+            // Storing valid lines in the output buffer, which is flushed once it's full
+            if(satisfiesFilters(row, plan.filters)) {
+                addRow(row, plan, target);
+            }
+            return !target.isStopped();
+        });
+        return;
+    }
+
+    // The quoted fields are compared without their quotes, but they are written as they are in the input,
+    // so the output is still valid CSV. In strict mode only the fields read by the query are validated
+    bool strict = plan.quoteMode == QuoteMode::Strict;
+    std::string unquoted; // Value of the last field with escaped quotes
+    bool unterminated = forEachRow(begin, end, plan.fieldsNeeded, true, fields, [&](const std::vector<std::string_view>& row) {
+        if (strict) {
+            for (std::string_view field : row) {
+                if (!isValidQuotedField(field)) {
+                    throw std::runtime_error("Invalid quoted field: '" + std::string(field) + "'");
+                }
+            }
+        }
+        if (satisfiesFilters(plan.filters, [&](int columnIndex) { return unquoteField(fieldAt(row, columnIndex), unquoted); })) {
+            addRow(row, plan, target);
+        }
+        return !target.isStopped();
+    });
+    if (unterminated && strict) {
+        throw std::runtime_error("Invalid quoted field: the CSV ends inside a quoted field");
+    }
+}
+
+// Size of the windows used to walk through big inputs. In the streaming mode it's the size of each read,
+// and for memory mapped files it's how much is processed before the pages behind are released
+constexpr size_t kDefaultChunkSize = 4 << 20;
+
+// Size of the slices of rows (morsels) the threads take at once. Smaller inputs aren't worth splitting
+constexpr size_t kParallelSliceSize = 1 << 20;
+
+// Slices of each chunk per thread. A thread whose slices are processed faster (narrower rows, fewer matches)
+// steals the slices left to the others, so all threads finish the chunk together
+constexpr size_t kSlicesPerThread = 4;
+
+// Bytes after the header given to bindQuery to infer the column types
+constexpr size_t kTypeSampleSize = 64 << 10;
+
+// Splits the rows of an input in chunks. With a row index of the input, the row boundaries are looked up
+// instead of scanned
+struct RowSplitter
+{
+    const char* data;                 // Start of the input. The offsets of the index are relative to it
+    bool quoted;
+    const RowIndex* index = nullptr;
+
+    // Returns the start of the first row at least chunkSize bytes after begin (or end if there's none).
+    // begin must be the start of a row, so with quoting we know which newlines are inside quoted fields
+    const char* findChunkEnd(const char* begin, const char* end, size_t chunkSize) const {
+        if (static_cast<size_t>(end - begin) <= chunkSize) return end;
+        if (index == nullptr) return findRowEnd(begin, begin + chunkSize, end, quoted);
+
+        auto entry = std::lower_bound(index->offsets.begin(), index->offsets.end(), static_cast<uint64_t>(begin + chunkSize - data));
+        return entry != index->offsets.end() && data + *entry < end ? data + *entry : end;
+    }
+
+    // Skip up to rows rows from begin, which must be the start of a row, and returns the start of the next one
+    // (or end if there aren't so many). rows is decreased by the number of rows skipped
+    const char* skipRows(const char* begin, const char* end, size_t& rows) const {
+        while (rows > 0 && begin < end) {
+            begin = findRowEnd(begin, begin, end, quoted);
+            --rows;
+        }
+        return begin;
+    }
+
+    // Returns the start of the row number row after the header, where rowsBegin is the start of the row 0
+    const char* seekRow(const char* rowsBegin, const char* end, size_t row) const {
+        if (index == nullptr) return skipRows(rowsBegin, end, row);
+        if (row >= index->rowCount) return end;
+        size_t rowsAfterEntry = row % index->rowsPerEntry;
+        return skipRows(data + index->offsets[row / index->rowsPerEntry], end, rowsAfterEntry);
+    }
+};
+
+// Threads available to process a CSV. The pool is only taken once an input big enough to be split shows up,
+// and it's given back at the end of the run to be reused by the next one (see acquireThreadPool)
+struct Workers
+{
+    int threadCount = resolveThreadCount();
+    std::unique_ptr<ThreadPool> pool;
+
+    ~Workers() {
+        if (pool) releaseThreadPool(std::move(pool));
+    }
+
+    ThreadPool& getPool() {
+        if (!pool) pool = acquireThreadPool(threadCount);
+        return *pool;
+    }
+};
+
+// Process the rows in [begin, end) splitting them in slices of about kParallelSliceSize bytes, which the threads
+// of the pool share by work stealing. The rows of each slice are written in its own buffer, and the buffers
+// are appended to the output in the order of the slices, so the rows are written in the same order as processRows would write them
+void processRowsParallel(const char* begin, const char* end, const QueryPlan& plan, RowTarget& target, Workers& workers,
+                         const RowSplitter& splitter) {
+    size_t size = end - begin;
+    if (workers.threadCount <= 1 || size < 2 * kParallelSliceSize) {
+        processRows(begin, end, plan, target);
+        return;
+    }
+
+    // Splitting the rows in slices of (about) the same size
+    size_t sliceCount = size / kParallelSliceSize;
+    std::vector<const char*> sliceBounds = {begin};
+    for (size_t i = 1; i < sliceCount; ++i) {
+        sliceBounds.push_back(splitter.findChunkEnd(sliceBounds.back(), end, size / sliceCount));
+    }
+    sliceBounds.push_back(end);
+
+    std::vector<RowTarget> sliceTargets = target.slices(plan, sliceCount);
+    workers.getPool().parallelFor(sliceCount, [&](size_t i) {
+        processRows(sliceBounds[i], sliceBounds[i + 1], plan, sliceTargets[i]);
+        sliceTargets[i].finishSlice();
+    });
+
+    for (RowTarget& sliceTarget : sliceTargets) {
+        target.append(sliceTarget);
+    }
+}
+
+// Options of processCsvBuffer, mostly for memory mapped files
+struct BufferOptions
+{
+    // The buffer is a file mapping, and the pages already processed are given back to the kernel after every chunk
+    // so the resident memory stays bounded even for files larger than the RAM
+    bool releasePages = false;
+    const RowIndex* index = nullptr; // Row index of the buffer. It's only used if it was built with the quoting of the query
+    const ZoneMap* zoneMap = nullptr; // Zone map of the buffer, with the same condition. It's only used to process all rows
+    RunOptions run;
+};
+
+// Process the CSV data stored in the buffer [data, data + size). The buffer doesn't need to be null terminated,
+// which allows us to process a memory mapped file without copying it. Returns the number of rows that satisfied
+// the filters (in the exists mode, only up to the first one).
+// It throws a runtime_error if the query doesn't match the header of the CSV
+size_t processCsvBuffer(const char* data, size_t size, CsvQuery& query, CsvSink& sink, const BufferOptions& options = BufferOptions()) {
+    const char* end = data + size;
+    query.stats = QueryStats();
+
     // Taking the first line of the csvData (headers columns line)
-    std::istringstream streamCsv(csv);
-    std::string headerColumnsLine;
-    std::getline(streamCsv, headerColumnsLine);
+    bool quoted = query.quoteMode != QuoteMode::None;
+    const char* rowsBegin = findRowEnd(data, data, end, quoted);
+    const char* headerEnd = rowsBegin > data && rowsBegin[-1] == '\n' ? rowsBegin - 1 : rowsBegin;
 
-    // Spliting the headerColumnsLine by commas into a vector of strings
-    std::istringstream headerColumnsStream(headerColumnsLine);
-    std::vector<std::string> headerColumns;
-    std::string column;
-    while (std::getline(headerColumnsStream, column, ',')) {
-        headerColumns.push_back(column);
+    const QueryPlan& boundPlan = bindQuery(query, std::string_view(data, headerEnd - data),
+                                           std::string_view(rowsBegin, std::min<size_t>(end - rowsBegin, kTypeSampleSize)));
+    const RunOptions& run = options.run;
+    QueryPlan filterPlan;
+    const QueryPlan& plan = planForMode(boundPlan, run.mode, filterPlan);
+
+    RowTarget target(plan, &sink, run.mode);
+    target.setLimit(query.offset, query.limit);
+    if (run.mode == RunMode::Rows) writeHeader(plan, target.output);
+
+    // Every chunk is split between the threads, so it has kSlicesPerThread slices per thread
+    Workers workers;
+    size_t chunkSize = std::max(kDefaultChunkSize, workers.threadCount * kSlicesPerThread * kParallelSliceSize);
+
+    RowSplitter splitter = {data, quoted};
+    if (options.index != nullptr && options.index->quoted == quoted) {
+        splitter.index = options.index;
+    }
+
+    // Only the rows [firstRow, firstRow + rowCount) are processed. With an index they are found without scanning the rows before
+    const char* cursor = rowsBegin;
+    if (run.firstRow > 0 || run.rowCount != SIZE_MAX) {
+        cursor = splitter.seekRow(rowsBegin, end, run.firstRow);
+        if (run.rowCount < SIZE_MAX - run.firstRow && splitter.index != nullptr) {
+            end = splitter.seekRow(rowsBegin, end, run.firstRow + run.rowCount);
+        } else if (run.rowCount != SIZE_MAX) {
+            size_t rowCount = run.rowCount;
+            end = splitter.skipRows(cursor, end, rowCount);
+        }
     }
 
-    // We'll store the header columns name and its index just if it's in the selectedColumns
-    // If selectedColumns is empty, we'll store all headers
-    std::vector<HeaderColumn> headerColumnsToSelect; // Array to store the header columns name and its index
-    if (selectedColumns[0] == '\0') { // selectedColumns is empty
-        for(int i = 0; i < headerColumns.size(); i++){
-            headerColumnsToSelect.push_back({headerColumns[i], i});
+    // Ranges of rows to be processed. With a zone map, the blocks that can't satisfy the filters are left out
+    // (and their pages are never read), and the consecutive blocks that remain are processed as a single range.
+    // The strict quoting checks every field, so it never skips a block
+    std::vector<std::pair<const char*, const char*>> ranges;
+    const ZoneMap* zoneMap = options.zoneMap;
+    if (zoneMap != nullptr && zoneMap->quoted == quoted && query.quoteMode != QuoteMode::Strict
+        && run.firstRow == 0 && run.rowCount == SIZE_MAX) {
+        for (size_t i = 0; i < zoneMap->blocks.size(); ++i) {
+            const char* blockBegin = data + zoneMap->blocks[i].offset;
+            const char* blockEnd = i + 1 < zoneMap->blocks.size() ? data + zoneMap->blocks[i + 1].offset : end;
+            if (!blockMaySatisfyFilters(zoneMap->blocks[i], plan.filters)) {
+                ++query.stats.blocksSkipped;
+            } else {
+                ++query.stats.blocksScanned;
+                if (!ranges.empty() && ranges.back().second == blockBegin) {
+                    ranges.back().second = blockEnd;
+                } else {
+                    ranges.emplace_back(blockBegin, blockEnd);
+                }
+            }
         }
     } else {
-        // Creating an unordered_map to store the header name and its index.
-        // It will be used to find the index of the selectedColumns with complexity O(1)
-        std::unordered_map<std::string, int> headerColumnIndexMap;
-        for (int i = 0; i < headerColumns.size(); ++i) {
-            headerColumnIndexMap[headerColumns[i]] = i;
-        }
-
-        std::istringstream selectedColumnsStream(selectedColumns);
-        std::string column;
-        // We'll iterate over the selectedColumns with complexity O(n) where n is the number of selectedColumns
-        // The complexity time of this block is O(n) * O(1) = O(n)
-        while(std::getline(selectedColumnsStream, column, ',')){
-            // Checking if the column is in the headerColumnIndexMap
-            auto it = headerColumnIndexMap.find(column); // find in an unordered_map has complexity O(1)
-            if (it != headerColumnIndexMap.end()) {
-                headerColumnsToSelect.push_back({it->first, it->second});
+        ranges.emplace_back(cursor, end);
+    }
+
+    // Processing the rows chunk by chunk. Each chunk ends right after a '\n', so no row is split.
+    // Once the target is stopped, the chunks left (and their pages) are never touched
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const char* released = data;
+    for (const auto& range : ranges) {
+        for (cursor = range.first; cursor < range.second && !target.isStopped();) {
+            const char* chunkEnd = splitter.findChunkEnd(cursor, range.second, chunkSize);
+
+            // The kernel reads the pages of the next chunk in the background while this one is processed,
+            // so the reading of a file mapping overlaps with the processing like a ChunkReader does for streams.
+            // A run that may stop early doesn't, since the next chunk may never be needed
+            if (options.releasePages && chunkEnd < range.second && !target.mayStopEarly()) {
+                const char* prefetchBegin = data + ((chunkEnd - data) / pageSize) * pageSize;
+                size_t prefetchSize = std::min<size_t>(range.second - prefetchBegin, chunkSize + pageSize);
+                madvise(const_cast<char*>(prefetchBegin), prefetchSize, MADV_WILLNEED);
+            }
+            processRowsParallel(cursor, chunkEnd, plan, target, workers, splitter);
+            cursor = chunkEnd;
+
+            if (options.releasePages) {
+                // Only whole pages that were completely processed can be released
+                const char* releaseEnd = data + ((cursor - data) / pageSize) * pageSize;
+                if (releaseEnd > released) {
+                    madvise(const_cast<char*>(released), releaseEnd - released, MADV_DONTNEED);
+                    released = releaseEnd;
+                }
+            }
+        }
+    }
+    target.finish();
+    return target.matches;
+}
+
+// Process the CSV read from the file descriptor in chunks of chunkSize bytes.
+// Only a few chunks (see ChunkReader) and output buffers are kept in memory,
+// so the memory used is constant no matter how big the input is. Only the rows [firstRow, firstRow + rowCount)
+// after the header are processed, and the reading stops after the last one (or once the target is stopped).
+// Returns the number of rows that satisfied the filters, like processCsvBuffer.
+// It throws a runtime_error if the query doesn't match the header of the CSV
+size_t processCsvStream(int fd, CsvQuery& query, CsvSink& sink, size_t chunkSize, const RunOptions& run = RunOptions()) {
+    query.stats = QueryStats();
+    if (chunkSize == 0) chunkSize = kDefaultChunkSize;
+
+    std::vector<char> buffer(chunkSize);
+    size_t filled = 0;      // Bytes of the buffer with data
+    bool endOfFile = false;
+
+    // Reading from the file descriptor until the buffer is full or the file is over
+    auto fillBuffer = [&]() {
+        while (filled < buffer.size() && !endOfFile) {
+            ssize_t bytesRead = read(fd, buffer.data() + filled, buffer.size() - filled);
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead < 0) throw ReadError(errno);
+            if (bytesRead == 0) {
+                endOfFile = true;
             } else {
-                std::cerr << "Header '" << column << "' not found in CSV file/string" << std::endl;
-                return;
+                filled += bytesRead;
             }
         }
+    };
+
+    // Reading until we have the whole header line. The buffer grows if the header is bigger than a chunk
+    bool quoted = query.quoteMode != QuoteMode::None;
+    fillBuffer();
+    while (findLastRowEnd(buffer.data(), buffer.data() + filled, quoted) == buffer.data() && !endOfFile) {
+        buffer.resize(buffer.size() * 2);
+        fillBuffer();
     }
+    size_t start = findRowEnd(buffer.data(), buffer.data(), buffer.data() + filled, quoted) - buffer.data();
+    size_t headerSize = start > 0 && buffer[start - 1] == '\n' ? start - 1 : start;
 
-    // Before any processing, we need to sort the headerColumnsToSelect by the index
-    // Therefore, we'll have the selected columns in the correct order
-    // The std::sort has complexity O(n log n) where n is the number of selected columns
-    std::sort(headerColumnsToSelect.begin(), headerColumnsToSelect.end(), [](const HeaderColumn& a, const HeaderColumn& b) {
-        return a.index < b.index;
-    }); 
+    const QueryPlan& boundPlan = bindQuery(query, std::string_view(buffer.data(), headerSize),
+                                           std::string_view(buffer.data() + start, std::min<size_t>(filled - start, kTypeSampleSize)));
+    QueryPlan filterPlan;
+    const QueryPlan& plan = planForMode(boundPlan, run.mode, filterPlan);
 
-    // Storing the selected columns in a buffer output to print them at the end
-    std::stringstream bufferHeaderColumnsToSelect;
-    for (int i = 0; i < headerColumnsToSelect.size(); ++i) {
-        bufferHeaderColumnsToSelect << headerColumnsToSelect[i].name;
-        if (i < headerColumnsToSelect.size() - 1) bufferHeaderColumnsToSelect << ",";
+    RowTarget target(plan, &sink, run.mode);
+    target.setLimit(query.offset, query.limit);
+    if (run.mode == RunMode::Rows) writeHeader(plan, target.output);
+
+    // Processing the complete rows of a chunk, skipping the ones before firstRow and the ones after the last row selected
+    Workers workers;
+    size_t firstRow = run.firstRow;
+    size_t rowCount = run.rowCount;
+    auto processChunk = [&](const char* begin, const char* rowsEnd) {
+        RowSplitter splitter = {begin, quoted};
+        begin = splitter.skipRows(begin, rowsEnd, firstRow);
+        if (rowCount != SIZE_MAX) rowsEnd = splitter.skipRows(begin, rowsEnd, rowCount);
+        processRowsParallel(begin, rowsEnd, plan, target, workers, splitter);
+    };
+
+    // An input that fits in the first read is processed right away. Otherwise a ChunkReader thread reads the next chunks
+    // while the current one is processed, and the writer thread of the output writes the rows of the previous ones
+    if (endOfFile) {
+        processChunk(buffer.data() + start, buffer.data() + filled);
+    } else {
+        ChunkReader reader(fd, chunkSize, quoted, std::string_view(buffer.data() + start, filled - start),
+                           target.mayStopEarly() ? 1 : kPipelineDepth);
+        std::vector<char>().swap(buffer);
+        std::string_view chunk;
+        while (rowCount > 0 && !target.isStopped() && reader.next(chunk)) {
+            processChunk(chunk.data(), chunk.data() + chunk.size());
+        }
     }
-    bufferHeaderColumnsToSelect << "\n";
+    target.finish();
+    return target.matches;
+}
 
-    // Preprocessing the rowFilterDefinitions based on all columns. 
-    // It's throw a error if a filter has a non-existent column or there's an invalid filter
-    std::vector<Filter> filters;
-    try {
-        filters = preprocessFilters(headerColumns, rowFilterDefinitions);
-    } catch(const std::runtime_error& e){
-        std::cerr << e.what() << std::endl;
-        return;
+// Rows of the columnar cache given to each thread at once
+constexpr size_t kColumnarSliceRows = 1 << 16;
+
+// Process the rows [begin, end) of the columnar cache, writing the ones that satisfy the filters in the output.
+// The filters run column by column over a selection vector: each group only reads the values of its column
+// for the rows that satisfied the previous groups. The groups of dictionary encoded columns were evaluated once
+// per code (codeBitmaps has one bitmap per group), so their rows only look up the bit of their code.
+// Then the selected columns of the remaining rows are written
+void processColumnarRows(const ColumnarCache& cache, size_t begin, size_t end, const QueryPlan& plan,
+                         const std::vector<CodeBitmap>& codeBitmaps, RowTarget& target) {
+    bool quoted = cache.isQuoted();
+    std::string unquoted;
+
+    // With strict quoting the fields read by the query are validated in the same order as processRows does
+    if (plan.quoteMode == QuoteMode::Strict) {
+        for (size_t row = begin; row < end; ++row) {
+            for (size_t column = 0; column < plan.fieldsNeeded; ++column) {
+                std::string_view field = cache.column(column).value(row);
+                if (!isValidQuotedField(field)) {
+                    throw std::runtime_error("Invalid quoted field: '" + std::string(field) + "'");
+                }
+            }
+        }
     }
 
-    // Processing the rows based on the selected columns and the filters
-    std::string line;
-    std::stringstream bufferDataOutput; // Buffer to store the data output
-    while (std::getline(streamCsv, line)) {
-        std::istringstream lineStream(line);
-        std::string field;
-        std::vector<std::string> row;
-
-        while (std::getline(lineStream, field, ',')) {
-            row.push_back(field);
-        }
-        
-        // Checking if the row satisfies the filters
-        try {
-            if(satisfiesFilters(row, filters)) {
-            // Storing valid lines in an output buffer to print them at the end
-            for (int i = 0; i < headerColumnsToSelect.size(); ++i) {
-                bufferDataOutput << row[headerColumnsToSelect[i].index];
-                if (i < headerColumnsToSelect.size() - 1) bufferDataOutput << ",";
+    std::vector<uint32_t> selection;
+    selection.reserve(end - begin);
+    for (size_t row = begin; row < end; ++row) {
+        selection.push_back(static_cast<uint32_t>(row - begin));
+    }
+    for (size_t g = 0; g < plan.filters.groups.size(); ++g) {
+        const FilterGroup& group = plan.filters.groups[g];
+        const ColumnView& column = cache.column(group.columnIndex);
+        size_t selected = 0;
+        if (column.encoding == ColumnEncoding::Dictionary) {
+            const CodeBitmap& bitmap = codeBitmaps[g];
+            if (bitmap.all) continue;
+            const uint32_t* codes = column.codes + begin;
+            for (uint32_t row : selection) {
+                selection[selected] = row;
+                selected += bitmap.test(codes[row]);
             }
-                bufferDataOutput << "\n";
+        } else {
+            for (uint32_t row : selection) {
+                std::string_view field = column.value(begin + row);
+                if (quoted) field = unquoteField(field, unquoted);
+                if (satisfiesGroup(field, plan.filters, group)) selection[selected++] = row;
             }
-        } catch(const std::runtime_error& e) {
-            std::cerr << e.what() << '\n';
-            return;
         }
+        selection.resize(selected);
+    }
+
+    if (target.mode != RunMode::Rows) {
+        target.addMatches(selection.size());
+        return;
     }
 
-    // Showing all buffers content in the console
-    std::cout << bufferHeaderColumnsToSelect.str() << bufferDataOutput.str();
-    
+    const std::pmr::vector<HeaderColumn>& headerColumnsToSelect = plan.headerColumnsToSelect;
+    OutputBuffer& output = target.output;
+    for (uint32_t row : selection) {
+        target.add([&](int columnIndex) { return cache.column(columnIndex).value(begin + row); }, [&]() {
+            for (size_t i = 0; i < headerColumnsToSelect.size(); ++i) {
+                output.append(cache.column(headerColumnsToSelect[i].index).value(begin + row));
+                if (i < headerColumnsToSelect.size() - 1) output.put(',');
+            }
+            output.put('\n');
+            output.flushIfFull();
+        });
+        if (target.isStopped()) break;
+    }
+}
+
+// Process the rows [firstRow, firstRow + rowCount) of a CSV file with its columnar cache. The header is still read
+// from the CSV data, which the cache was checked against. The number of rows that satisfied the filters is stored
+// in matches. Returns false (without writing anything) if the cache can't answer the query: it was built
+// with a different quoting, it doesn't have a column of the query, or a column of the query is corrupt
+bool processColumnarCache(const ColumnarCache& cache, const char* data, size_t size, CsvQuery& query, CsvSink& sink,
+                          const RunOptions& run, size_t& matches) {
+    bool quoted = query.quoteMode != QuoteMode::None;
+    if (cache.isQuoted() != quoted) {
+        return false;
+    }
+    query.stats = QueryStats();
+
+    const char* end = data + size;
+    const char* rowsBegin = findRowEnd(data, data, end, quoted);
+    const char* headerEnd = rowsBegin > data && rowsBegin[-1] == '\n' ? rowsBegin - 1 : rowsBegin;
+    const QueryPlan& boundPlan = bindQuery(query, std::string_view(data, headerEnd - data),
+                                           std::string_view(rowsBegin, std::min<size_t>(end - rowsBegin, kTypeSampleSize)));
+    QueryPlan filterPlan;
+    const QueryPlan& plan = planForMode(boundPlan, run.mode, filterPlan);
+    if (plan.fieldsNeeded > cache.columnCount()) {
+        return false;
+    }
+
+    size_t firstRow = run.firstRow;
+    size_t rowCount = run.rowCount;
+    size_t rowsEnd = cache.rowCount();
+    if (firstRow > rowsEnd) firstRow = rowsEnd;
+    if (rowCount < rowsEnd - firstRow) rowsEnd = firstRow + rowCount;
+
+    // Only the columns read by the query are checked. In strict mode every field up to the last one used is validated
+    std::vector<bool> usedColumns(plan.fieldsNeeded, plan.quoteMode == QuoteMode::Strict);
+    for (const FilterGroup& group : plan.filters.groups) usedColumns[group.columnIndex] = true;
+    for (const HeaderColumn& column : plan.headerColumnsToSelect) usedColumns[column.index] = true;
+    for (const Aggregate& aggregate : plan.aggregates) {
+        if (aggregate.columnIndex >= 0) usedColumns[aggregate.columnIndex] = true;
+    }
+    for (size_t i = 0; i < usedColumns.size(); ++i) {
+        if (usedColumns[i] && !cache.isColumnValid(i, firstRow, rowsEnd)) return false;
+    }
+
+    RowTarget target(plan, &sink, run.mode);
+    target.setLimit(query.offset, query.limit);
+    if (run.mode == RunMode::Rows) writeHeader(plan, target.output);
+
+    // The filters of the dictionary encoded columns are evaluated once per distinct value. If no value of a column
+    // satisfies its group, no row can match, and the rows are only read to validate them in strict mode
+    std::vector<CodeBitmap> codeBitmaps(plan.filters.groups.size());
+    std::string unquoted;
+    for (size_t g = 0; g < plan.filters.groups.size(); ++g) {
+        const FilterGroup& group = plan.filters.groups[g];
+        const ColumnView& column = cache.column(group.columnIndex);
+        if (column.encoding != ColumnEncoding::Dictionary) continue;
+        codeBitmaps[g] = evaluateGroupOnCodes(plan.filters, group, column.entryCount, [&](size_t code) {
+            return quoted ? unquoteField(column.entry(code), unquoted) : column.entry(code);
+        });
+        if (!codeBitmaps[g].any && plan.quoteMode != QuoteMode::Strict) rowsEnd = firstRow;
+    }
+
+    // Every batch of rows is split in kSlicesPerThread slices per thread, and the outputs of the slices are appended in order
+    Workers workers;
+    size_t batchRows = workers.threadCount * kSlicesPerThread * kColumnarSliceRows;
+    for (size_t batchBegin = firstRow; batchBegin < rowsEnd && !target.isStopped(); batchBegin += batchRows) {
+        size_t batchEnd = std::min(rowsEnd, batchBegin + batchRows);
+        size_t sliceCount = (batchEnd - batchBegin + kColumnarSliceRows - 1) / kColumnarSliceRows;
+        if (sliceCount <= 1 || workers.threadCount <= 1) {
+            processColumnarRows(cache, batchBegin, batchEnd, plan, codeBitmaps, target);
+            continue;
+        }
+
+        std::vector<RowTarget> sliceTargets = target.slices(plan, sliceCount);
+        workers.getPool().parallelFor(sliceCount, [&](size_t i) {
+            size_t sliceBegin = batchBegin + i * kColumnarSliceRows;
+            processColumnarRows(cache, sliceBegin, std::min(batchEnd, sliceBegin + kColumnarSliceRows), plan, codeBitmaps,
+                                sliceTargets[i]);
+            sliceTargets[i].finishSlice();
+        });
+        for (RowTarget& sliceTarget : sliceTargets) {
+            target.append(sliceTarget);
+        }
+    }
+
+    if (plan.quoteMode == QuoteMode::Strict && cache.isUnterminated() && rowsEnd == cache.rowCount() && !target.isStopped()) {
+        throw std::runtime_error("Invalid quoted field: the CSV ends inside a quoted field");
+    }
+    target.finish();
+    matches = target.matches;
+    return true;
+}
+
+// Process the opened CSV file with the query. Pipes and other non-regular files can't be mapped, so we read them as a stream.
+// If the file has a fresh columnar cache next to it, the query is answered from the cache. Otherwise a fresh row index
+// is used to split the rows, and a fresh zone map to skip blocks. Only the rows [firstRow, firstRow + rowCount)
+// after the header are processed. Returns the number of rows that satisfied the filters, like processCsvBuffer
+size_t processOpenedFile(const MappedFile& file, const char csvFilePath[], CsvQuery& query, CsvSink& sink,
+                         const RunOptions& run = RunOptions()) {
+    if (file.isMapped()) {
+        ColumnarCache cache;
+        size_t matches;
+        if (cache.open(columnarCachePath(csvFilePath), file.status(), file.data(), file.size())
+            && processColumnarCache(cache, file.data(), file.size(), query, sink, run, matches)) {
+            return matches;
+        }
+
+        RowIndex index;
+        ZoneMap zoneMap;
+        BufferOptions options;
+        options.releasePages = true;
+        options.run = run;
+        if (loadRowIndex(rowIndexPath(csvFilePath), file.status(), file.data(), file.size(), index)) {
+            options.index = &index;
+        }
+        if (loadZoneMap(zoneMapPath(csvFilePath), file.status(), file.data(), file.size(), zoneMap)) {
+            options.zoneMap = &zoneMap;
+        }
+        return processCsvBuffer(file.data(), file.size(), query, sink, options);
+    } else {
+        // A stream can't be indexed, so the rows before firstRow are read and skipped
+        return processCsvStream(file.descriptor(), query, sink, kDefaultChunkSize, run);
+    }
+}
+
+void processCsv(const char csv[], const char selectedColumns[], const char rowFilterDefinitions[]) {
+    CsvSink sink = csvStdoutSink();
+    processCsvToSink(csv, selectedColumns, rowFilterDefinitions, &sink);
 }
 
 void processCsvFile(const char csvFilePath[], const char selectedColumns[], const char rowFilterDefinitions[]) {
-    // Reading the CSV file
-    std::ifstream file(csvFilePath);
-    if (!file.is_open()) {
+    CsvSink sink = csvStdoutSink();
+    processCsvFileToSink(csvFilePath, selectedColumns, rowFilterDefinitions, &sink);
+}
+
+void processCsvAggregate(const char csv[], const char selectedColumns[], const char aggregates[], const char rowFilterDefinitions[]) {
+    try {
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+        query.aggregateDefinitions = parseAggregateDefinitions(aggregates, query.arena);
+        CsvSink sink = csvStdoutSink();
+        processCsvBuffer(csv, std::strlen(csv), query, sink);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void processCsvFileAggregate(const char csvFilePath[], const char selectedColumns[], const char aggregates[],
+                             const char rowFilterDefinitions[]) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+        query.aggregateDefinitions = parseAggregateDefinitions(aggregates, query.arena);
+        CsvSink sink = csvStdoutSink();
+        processOpenedFile(file, csvFilePath, query, sink);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void processCsvToSink(const char csv[], const char selectedColumns[], const char rowFilterDefinitions[], CsvSink* sink) {
+    try {
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+        processCsvBuffer(csv, std::strlen(csv), query, *sink);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void processCsvFileToSink(const char csvFilePath[], const char selectedColumns[], const char rowFilterDefinitions[], CsvSink* sink) {
+    try {
+        // Mapping the CSV file in memory. It's opened first, so an invalid path is reported before an invalid query
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+
+        processOpenedFile(file, csvFilePath, query, *sink);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void processCsvFileStream(const char csvFilePath[], const char selectedColumns[], const char rowFilterDefinitions[], size_t chunkSize) {
+    int fd = open(csvFilePath, O_RDONLY);
+    if (fd < 0) {
         std::cerr << "Error opening CSV file" << std::endl;
         return;
     }
 
-    // We'll store the csv data in a string
-    std::string csvString;
-    std::getline(file, csvString); // Getting the first line
+    // The kernel reads ahead more aggressively if it knows the file is read sequentially
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    try {
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+        CsvSink sink = csvStdoutSink();
+        processCsvStream(fd, query, sink, chunkSize);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+    close(fd);
+}
+
+CsvSink csvStdoutSink() {
+    CsvSink sink = {};
+    sink.type = CSV_SINK_STDOUT;
+    return sink;
+}
+
+CsvSink csvBufferSink(char* buffer, size_t capacity) {
+    CsvSink sink = {};
+    sink.type = CSV_SINK_BUFFER;
+    sink.buffer = buffer;
+    sink.capacity = capacity;
+    return sink;
+}
+
+CsvSink csvFdSink(int fd) {
+    CsvSink sink = {};
+    sink.type = CSV_SINK_FD;
+    sink.fd = fd;
+    return sink;
+}
+
+CsvSink csvCallbackSink(CsvWriteCallback callback, void* context) {
+    CsvSink sink = {};
+    sink.type = CSV_SINK_CALLBACK;
+    sink.callback = callback;
+    sink.context = context;
+    return sink;
+}
+
+int setCsvScanLevel(const char level[]) {
+    if (std::strcmp(level, "auto") == 0) {
+        resetScanLevel();
+        return 1;
+    }
+    ScanLevel scanLevel;
+    if (!parseScanLevel(level, scanLevel)) {
+        return 0;
+    }
+    return setScanLevel(scanLevel) ? 1 : 0;
+}
+
+void setCsvThreadCount(int threadCount) {
+    setThreadCount(threadCount);
+}
+
+CsvQuery* csvQueryPrepare(const char selectedColumns[], const char rowFilterDefinitions[]) {
+    std::unique_ptr<CsvQuery> query(new CsvQuery());
+    try {
+        parseQuery(*query, selectedColumns, rowFilterDefinitions);
+        return query.release();
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+void csvQueryRun(CsvQuery* query, const char csv[]) {
+    CsvSink sink = csvStdoutSink();
+    csvQueryRunToSink(query, csv, &sink);
+}
+
+void csvQueryRunFile(CsvQuery* query, const char csvFilePath[]) {
+    CsvSink sink = csvStdoutSink();
+    csvQueryRunFileToSink(query, csvFilePath, &sink);
+}
+
+void csvQueryRunToSink(CsvQuery* query, const char csv[], CsvSink* sink) {
+    try {
+        processCsvBuffer(csv, std::strlen(csv), *query, *sink);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void csvQueryRunFileToSink(CsvQuery* query, const char csvFilePath[], CsvSink* sink) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+
+        processOpenedFile(file, csvFilePath, *query, *sink);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void csvQueryRunFileRowsToSink(CsvQuery* query, const char csvFilePath[], size_t firstRow, size_t rowCount, CsvSink* sink) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+
+        RunOptions run;
+        run.firstRow = firstRow;
+        run.rowCount = rowCount;
+        processOpenedFile(file, csvFilePath, *query, *sink, run);
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+// Sink of the count and exists modes, which never write anything
+static CsvSink discardSink() {
+    return csvBufferSink(nullptr, 0);
+}
+
+int csvQueryCount(CsvQuery* query, const char csv[], size_t* count) {
+    try {
+        RunOptions run;
+        run.mode = RunMode::Count;
+        BufferOptions options;
+        options.run = run;
+        CsvSink sink = discardSink();
+        *count = processCsvBuffer(csv, std::strlen(csv), *query, sink, options);
+        return 1;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
+    }
+}
+
+int csvQueryCountFile(CsvQuery* query, const char csvFilePath[], size_t* count) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+
+        RunOptions run;
+        run.mode = RunMode::Count;
+        CsvSink sink = discardSink();
+        *count = processOpenedFile(file, csvFilePath, *query, sink, run);
+        return 1;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
+    }
+}
+
+int csvQueryExists(CsvQuery* query, const char csv[]) {
+    try {
+        RunOptions run;
+        run.mode = RunMode::Exists;
+        BufferOptions options;
+        options.run = run;
+        CsvSink sink = discardSink();
+        return processCsvBuffer(csv, std::strlen(csv), *query, sink, options) > 0 ? 1 : 0;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int csvQueryExistsFile(CsvQuery* query, const char csvFilePath[]) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+
+        RunOptions run;
+        run.mode = RunMode::Exists;
+        CsvSink sink = discardSink();
+        return processOpenedFile(file, csvFilePath, *query, sink, run) > 0 ? 1 : 0;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int csvBuildZoneMap(const char csvFilePath[], size_t rowsPerBlock, CsvQuoteMode quoteMode) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+        if (!file.isMapped()) {
+            throw std::runtime_error("Error indexing CSV file: only regular files can be indexed");
+        }
 
-    // Adding the first newline in the string
-    csvString += "\n";
+        ZoneMap zoneMap = buildZoneMap(file.data(), file.size(), rowsPerBlock, quoteMode != CSV_QUOTES_NONE);
+        if (!writeZoneMap(zoneMapPath(csvFilePath), zoneMap, file.status(), file.data(), file.size())) {
+            throw std::runtime_error("Error writing the zone map of the CSV file");
+        }
+        return 1;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
+    }
+}
+
+int csvBuildColumnarCache(const char csvFilePath[], CsvQuoteMode quoteMode, int dictionaryEncode) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+        if (!file.isMapped()) {
+            throw std::runtime_error("Error indexing CSV file: only regular files can be indexed");
+        }
 
-    // Concatenating with the others lines
-    std::string line;
-    while (std::getline(file, line)) {
-        csvString += line;
-        csvString += "\n";
+        if (!writeColumnarCache(columnarCachePath(csvFilePath), file.status(), file.data(), file.size(),
+                                quoteMode != CSV_QUOTES_NONE, dictionaryEncode != 0)) {
+            throw std::runtime_error("Error writing the columnar cache of the CSV file");
+        }
+        return 1;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
     }
+}
+
+CsvQueryStats csvQueryGetStats(const CsvQuery* query) {
+    CsvQueryStats stats = {};
+    stats.blocksScanned = query->stats.blocksScanned;
+    stats.blocksSkipped = query->stats.blocksSkipped;
+    stats.arenaAllocations = query->arena.allocationCount() + query->planArena.allocationCount();
+    stats.arenaHeapBlocks = query->arena.heapBlockCount() + query->planArena.heapBlockCount();
+    return stats;
+}
 
-    // Converting the std::string to const char*
-    const char* csv = csvString.c_str();
+int csvBuildRowIndex(const char csvFilePath[], size_t rowsPerEntry, CsvQuoteMode quoteMode) {
+    try {
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+        if (!file.isMapped()) {
+            throw std::runtime_error("Error indexing CSV file: only regular files can be indexed");
+        }
 
-    // Calling the processCsv function with the new csv
-    processCsv(csv,selectedColumns, rowFilterDefinitions);
+        RowIndex index = buildRowIndex(file.data(), file.size(), rowsPerEntry, quoteMode != CSV_QUOTES_NONE);
+        if (!writeRowIndex(rowIndexPath(csvFilePath), index, file.status(), file.data(), file.size())) {
+            throw std::runtime_error("Error writing the row index of the CSV file");
+        }
+        return 1;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
+    }
+}
+
+void csvQuerySetQuoteMode(CsvQuery* query, CsvQuoteMode quoteMode) {
+    switch (quoteMode) {
+        case CSV_QUOTES_PERMISSIVE:
+            query->quoteMode = QuoteMode::Permissive;
+            break;
+        case CSV_QUOTES_STRICT:
+            query->quoteMode = QuoteMode::Strict;
+            break;
+        default:
+            query->quoteMode = QuoteMode::None;
+            break;
+    }
+    // The header is split in a different way, so the plan is built again on the next run
+    query->bound = false;
+}
+
+int csvQuerySetColumnType(CsvQuery* query, const char column[], CsvColumnType columnType) {
+    ColumnType type;
+    switch (columnType) {
+        case CSV_TYPE_TEXT:
+            type = ColumnType::Text;
+            break;
+        case CSV_TYPE_INTEGER:
+            type = ColumnType::Integer;
+            break;
+        case CSV_TYPE_FLOAT:
+            type = ColumnType::Float;
+            break;
+        case CSV_TYPE_DATE:
+            type = ColumnType::Date;
+            break;
+        default:
+            return 0;
+    }
+
+    // Setting the type of a column again replaces the previous one
+    auto it = std::find_if(query->columnTypes.begin(), query->columnTypes.end(), [&](const auto& columnType) {
+        return columnType.first == column;
+    });
+    if (it != query->columnTypes.end()) {
+        it->second = type;
+    } else {
+        query->columnTypes.emplace_back(query->arena.copy(column), type);
+    }
+    query->bound = false;
+    return 1;
+}
+
+void csvQueryInferTypes(CsvQuery* query, int inferTypes) {
+    query->inferTypes = inferTypes != 0;
+    query->bound = false;
+}
+
+int csvQuerySetAggregates(CsvQuery* query, const char aggregates[]) {
+    try {
+        query->aggregateDefinitions = parseAggregateDefinitions(aggregates, query->arena);
+        query->bound = false;
+        return 1;
+    } catch(const std::runtime_error& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
+    }
+}
+
+void csvQuerySetLimit(CsvQuery* query, size_t offset, size_t limit) {
+    query->offset = offset;
+    query->limit = limit;
+}
+
+void csvQueryFree(CsvQuery* query) {
+    delete query;
+}
+
+static void setResultError(CsvResult& result, CsvStatus status, const char message[]) {
+    result.status = status;
+    std::snprintf(result.message, sizeof(result.message), "%s", message);
+}
+
+// Run the body of a checked function, which reports the errors in its result instead of writing them to std::cerr.
+// The body sets failure to the status of the step it's running, and a runtime_error thrown by the step gets that status.
+// Once the body is done, a write that failed in the sink is an error too, since part of the output was lost
+template <typename Body>
+static CsvResult runChecked(CsvSink* sink, Body&& body) {
+    CsvResult result = {};
+    CsvStatus failure = CSV_ERROR_INTERNAL;
+    if (sink != nullptr) sink->error = 0;
+    try {
+        body(failure);
+        if (sink != nullptr && sink->error != 0) {
+            failure = CSV_ERROR_WRITING_OUTPUT;
+            throw std::runtime_error("Error writing the output: " + std::string(std::strerror(sink->error)));
+        }
+        result.status = CSV_OK;
+    } catch(const std::system_error& e){
+        // e.g. a thread of the pool couldn't be created. It's a runtime_error, but it's never caused by the input
+        setResultError(result, CSV_ERROR_INTERNAL, e.what());
+    } catch(const ReadError& e){
+        setResultError(result, CSV_ERROR_READING_INPUT, e.what());
+    } catch(const std::runtime_error& e){
+        setResultError(result, failure, e.what());
+    } catch(const std::exception& e){
+        setResultError(result, CSV_ERROR_INTERNAL, e.what());
+    }
+    return result;
+}
+
+CsvResult processCsvChecked(const char csv[], const char selectedColumns[], const char rowFilterDefinitions[], CsvSink* sink) {
+    return runChecked(sink, [&](CsvStatus& failure) {
+        failure = CSV_ERROR_INVALID_QUERY;
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+
+        failure = CSV_ERROR_INVALID_CSV;
+        processCsvBuffer(csv, std::strlen(csv), query, *sink);
+    });
+}
+
+CsvResult processCsvFileChecked(const char csvFilePath[], const char selectedColumns[], const char rowFilterDefinitions[], CsvSink* sink) {
+    return runChecked(sink, [&](CsvStatus& failure) {
+        failure = CSV_ERROR_OPENING_FILE;
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
+
+        failure = CSV_ERROR_INVALID_QUERY;
+        CsvQuery query(true);
+        parseQuery(query, selectedColumns, rowFilterDefinitions);
+
+        failure = CSV_ERROR_INVALID_CSV;
+        processOpenedFile(file, csvFilePath, query, *sink);
+    });
+}
+
+CsvResult csvQueryPrepareChecked(const char selectedColumns[], const char rowFilterDefinitions[], CsvQuery** query) {
+    *query = nullptr;
+    return runChecked(nullptr, [&](CsvStatus& failure) {
+        failure = CSV_ERROR_INVALID_QUERY;
+        std::unique_ptr<CsvQuery> prepared(new CsvQuery());
+        parseQuery(*prepared, selectedColumns, rowFilterDefinitions);
+        *query = prepared.release();
+    });
+}
+
+CsvResult csvQueryRunChecked(CsvQuery* query, const char csv[], CsvSink* sink) {
+    return runChecked(sink, [&](CsvStatus& failure) {
+        failure = CSV_ERROR_INVALID_QUERY;
+        if (query == nullptr) {
+            throw std::runtime_error("Invalid query: the query is NULL");
+        }
+
+        failure = CSV_ERROR_INVALID_CSV;
+        processCsvBuffer(csv, std::strlen(csv), *query, *sink);
+    });
+}
+
+CsvResult csvQueryRunFileChecked(CsvQuery* query, const char csvFilePath[], CsvSink* sink) {
+    return runChecked(sink, [&](CsvStatus& failure) {
+        failure = CSV_ERROR_INVALID_QUERY;
+        if (query == nullptr) {
+            throw std::runtime_error("Invalid query: the query is NULL");
+        }
+
+        failure = CSV_ERROR_OPENING_FILE;
+        MappedFile file(csvFilePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Error opening CSV file");
+        }
 
-    file.close();
+        failure = CSV_ERROR_INVALID_CSV;
+        processOpenedFile(file, csvFilePath, *query, *sink);
+    });
 }
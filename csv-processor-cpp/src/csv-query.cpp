@@ -0,0 +1,459 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+#include <cctype>
+#include "../includes/csv-query.hpp"
+#include "../includes/csv-scanner.hpp"
+
+bool parseComparator(std::string_view text, Comparator& comparator) {
+    if (text == ">") {
+        comparator = Comparator::Greater;
+    } else if (text == "<") {
+        comparator = Comparator::Less;
+    } else if (text == "=") {
+        comparator = Comparator::Equal;
+    } else if (text == "!=") {
+        comparator = Comparator::NotEqual;
+    } else if (text == ">=") {
+        comparator = Comparator::GreaterEqual;
+    } else if (text == "<=") {
+        comparator = Comparator::LessEqual;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Characters that can be part of a comparator. They can't be used in the column names or values of the filters
+static bool isComparatorCharacter(char c) {
+    return c == '<' || c == '>' || c == '=' || c == '!';
+}
+
+// Split a filter line in column, comparator and value in a single pass. The column and the value must not be empty
+// nor have comparator characters, and the comparator must have one or two comparator characters. Returns false otherwise.
+// A comparator that isn't one of the valid ones is reported by buildQueryPlan
+static bool lexFilterDefinition(std::string_view line, FilterDefinition& filterDefinition) {
+    size_t comparatorStart = 0;
+    while (comparatorStart < line.size() && !isComparatorCharacter(line[comparatorStart])) ++comparatorStart;
+
+    size_t valueStart = comparatorStart;
+    while (valueStart < line.size() && isComparatorCharacter(line[valueStart])) ++valueStart;
+
+    // The column and the value can't be empty, and a comparator has one or two characters
+    if (comparatorStart == 0 || valueStart == comparatorStart || valueStart - comparatorStart > 2 || valueStart == line.size()) {
+        return false;
+    }
+
+    // Anything after the comparator is the value, so it can't have another comparator
+    for (size_t i = valueStart; i < line.size(); ++i) {
+        if (isComparatorCharacter(line[i])) return false;
+    }
+
+    filterDefinition.comparatorText = line.substr(comparatorStart, valueStart - comparatorStart);
+    filterDefinition.validComparator = parseComparator(filterDefinition.comparatorText, filterDefinition.comparator);
+    filterDefinition.columnName = line.substr(0, comparatorStart);
+    filterDefinition.value = line.substr(valueStart);
+    return true;
+}
+
+std::pmr::vector<FilterDefinition> parseFilterDefinitions(std::string_view rowFilterDefinitions, QueryArena& arena) {
+    // Checking if the rowFilterDefinitions is empty
+    if(rowFilterDefinitions.empty()){
+        throw std::runtime_error("Invalid filter: There is no filter, rowFilterDefinitions is empty");
+    }
+
+    // The column names and the values of the filters are views of this copy
+    std::pmr::vector<FilterDefinition> filterDefinitions(&arena);
+    std::string_view definitions = arena.copy(rowFilterDefinitions);
+
+    // One filter per line. As with std::getline, a '\n' at the end doesn't start another (empty) filter
+    size_t lineStart = 0;
+    while (lineStart < definitions.size()) {
+        size_t lineEnd = definitions.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) lineEnd = definitions.size();
+        std::string_view filterDefinition = definitions.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        // Finding the headerColumnName, the comparator and the value
+        // If we don't find any valid comparator, we throw an error
+        FilterDefinition parsed;
+        if (!lexFilterDefinition(filterDefinition, parsed)) {
+            throw std::runtime_error("Invalid filter: '" + std::string(filterDefinition) + "'");
+        }
+        filterDefinitions.push_back(parsed);
+    }
+
+    return filterDefinitions;
+}
+
+// Convert the name of an aggregate function, in any case. Returns false if it isn't a valid function
+static bool parseAggregateFunction(std::string_view name, AggregateFunction& function) {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+    if (upper == "COUNT") {
+        function = AggregateFunction::Count;
+    } else if (upper == "SUM") {
+        function = AggregateFunction::Sum;
+    } else if (upper == "MIN") {
+        function = AggregateFunction::Minimum;
+    } else if (upper == "MAX") {
+        function = AggregateFunction::Maximum;
+    } else if (upper == "AVG") {
+        function = AggregateFunction::Average;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Split the text by the separator, as std::getline does: a separator at the end doesn't start another (empty) part
+template <typename Callback>
+static void forEachPart(std::string_view text, char separator, Callback callback) {
+    size_t partStart = 0;
+    while (partStart < text.size()) {
+        size_t partEnd = text.find(separator, partStart);
+        if (partEnd == std::string_view::npos) partEnd = text.size();
+        callback(text.substr(partStart, partEnd - partStart));
+        partStart = partEnd + 1;
+    }
+}
+
+std::pmr::vector<AggregateDefinition> parseAggregateDefinitions(std::string_view aggregates, QueryArena& arena) {
+    std::pmr::vector<AggregateDefinition> aggregateDefinitions(&arena);
+    forEachPart(arena.copy(aggregates), ',', [&](std::string_view text) {
+        // FUNCTION(column), where the column can only be * for COUNT
+        size_t open = text.find('(');
+        AggregateDefinition definition;
+        bool valid = open != std::string_view::npos && open > 0 && text.size() > open + 2 && text.back() == ')'
+            && parseAggregateFunction(text.substr(0, open), definition.function);
+        if (valid) {
+            definition.columnName = text.substr(open + 1, text.size() - open - 2);
+            if (definition.columnName == "*") {
+                valid = definition.function == AggregateFunction::Count;
+                definition.columnName = std::string_view();
+            }
+        }
+        if (!valid) {
+            throw std::runtime_error("Invalid aggregate: '" + std::string(text) + "'");
+        }
+        definition.text = text;
+        aggregateDefinitions.push_back(definition);
+    });
+    return aggregateDefinitions;
+}
+
+// Parse the value of a filter of a typed column. Returns false if the value isn't of the type
+static bool parseFilterValue(Filter& filter) {
+    switch (filter.type) {
+        case ColumnType::Integer:
+            return parseIntegerField(filter.value, filter.integerValue);
+        case ColumnType::Float:
+            return parseFloatField(filter.value, filter.floatValue);
+        case ColumnType::Date:
+            return parseDateField(filter.value, filter.integerValue);
+        default:
+            return true;
+    }
+}
+
+// Name of a column type, as used in the error messages
+static const char* columnTypeName(ColumnType type) {
+    switch (type) {
+        case ColumnType::Integer:
+            return "integer";
+        case ColumnType::Float:
+            return "float";
+        case ColumnType::Date:
+            return "date";
+        default:
+            return "text";
+    }
+}
+
+// The filters are sorted by column, so the filters of the same column are next to each other and form a group
+FilterPlan preprocessFilters(const std::pmr::vector<std::string_view>& headerColumns,
+                             const std::pmr::vector<FilterDefinition>& filterDefinitions,
+                             const std::pmr::vector<ColumnType>& columnTypes, std::pmr::memory_resource* resource){
+    std::pmr::vector<Filter> filters(resource);
+    filters.reserve(filterDefinitions.size());
+    for (const FilterDefinition& filterDefinition : filterDefinitions) {
+        // Finding the index of the headerColumnName in the headerColumns and storing the filter in the filters vector
+        auto it = std::find(headerColumns.begin(), headerColumns.end(), filterDefinition.columnName);
+        if(it != headerColumns.end()){
+            // An invalid comparator is reported by buildQueryPlan, once every column has been found
+            if (!filterDefinition.validComparator) continue;
+
+            int columnIndex = std::distance(headerColumns.begin(), it);
+            filters.push_back({columnIndex, filterDefinition.comparator, filterDefinition.value});
+
+            // The value of a typed column is parsed here, once, instead of for every row
+            Filter& filter = filters.back();
+            filter.type = static_cast<size_t>(columnIndex) < columnTypes.size() ? columnTypes[columnIndex] : ColumnType::Text;
+            if (!parseFilterValue(filter)) {
+                throw std::runtime_error("Invalid " + std::string(columnTypeName(filter.type)) + " value in filter: '"
+                                         + std::string(filterDefinition.columnName) + "' has the value '"
+                                         + std::string(filterDefinition.value) + "'");
+            }
+        } else {
+            throw std::runtime_error("Header '"+std::string(filterDefinition.columnName)+"' not found in CSV file/string");
+        }
+    }
+
+    // Grouping the filters by column. The stable sort keeps the order of the filters of each column
+    std::stable_sort(filters.begin(), filters.end(), [](const Filter& a, const Filter& b) {
+        return a.columnIndex < b.columnIndex;
+    });
+
+    FilterPlan plan(resource);
+    for (int i = 0; i < static_cast<int>(filters.size()); ++i) {
+        if (plan.groups.empty() || plan.groups.back().columnIndex != filters[i].columnIndex) {
+            plan.groups.push_back({filters[i].columnIndex, i, i});
+        }
+        plan.groups.back().end = i + 1;
+    }
+    plan.filters = std::move(filters);
+
+    return plan;
+}
+
+// Throw the error of the first filter with an invalid comparator. As with the original parser, which only found out when
+// checking a row, the message has the field of the first row instead of the column name, and there's no error without rows
+static void checkComparators(const CsvQuery& query, const std::pmr::vector<std::string_view>& headerColumns, std::string_view sample) {
+    auto invalid = std::find_if(query.filterDefinitions.begin(), query.filterDefinitions.end(), [](const FilterDefinition& filterDefinition) {
+        return !filterDefinition.validComparator;
+    });
+    if (invalid == query.filterDefinitions.end() || sample.empty()) {
+        return;
+    }
+
+    int columnIndex = std::find(headerColumns.begin(), headerColumns.end(), invalid->columnName) - headerColumns.begin();
+    bool quoted = query.quoteMode != QuoteMode::None;
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    std::string field;
+    forEachRow(sample.data(), sample.data() + sample.size(), columnIndex + 1, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        field = quoted ? unquoteField(fieldAt(row, columnIndex), scratch) : fieldAt(row, columnIndex);
+        return false;
+    });
+    throw std::runtime_error("Invalid filter: '" + field + std::string(invalid->comparatorText) + std::string(invalid->value) + "'");
+}
+
+void parseQuery(CsvQuery& query, const char selectedColumns[], const char rowFilterDefinitions[]) {
+    // If selectedColumns is empty, all columns will be selected
+    query.selectAllColumns = selectedColumns[0] == '\0';
+    if (!query.selectAllColumns) {
+        forEachPart(query.arena.copy(selectedColumns), ',', [&](std::string_view column) {
+            query.selectedColumns.push_back(column);
+        });
+    }
+
+    query.filterDefinitions = parseFilterDefinitions(rowFilterDefinitions, query.arena);
+}
+
+// Maximum number of rows of the sample used to infer the column types
+constexpr size_t kTypeSampleRows = 1000;
+
+// Resolve the type of each column: the types set in the query, and the types inferred from the sample
+// for the other filtered columns. A column is only inferred if the values of its filters have the inferred type,
+// so inference never turns a valid query into an invalid one
+static std::pmr::vector<ColumnType> resolveColumnTypes(const CsvQuery& query, const std::pmr::vector<std::string_view>& headerColumns,
+                                                       std::string_view sample, std::pmr::memory_resource* resource) {
+    std::pmr::vector<ColumnType> columnTypes(headerColumns.size(), ColumnType::Text, resource);
+    std::pmr::vector<bool> typeSet(headerColumns.size(), false, resource);
+    for (const auto& columnType : query.columnTypes) {
+        auto it = std::find(headerColumns.begin(), headerColumns.end(), columnType.first);
+        if (it == headerColumns.end()) {
+            throw std::runtime_error("Header '" + std::string(columnType.first) + "' not found in CSV file/string");
+        }
+        columnTypes[it - headerColumns.begin()] = columnType.second;
+        typeSet[it - headerColumns.begin()] = true;
+    }
+    if (!query.inferTypes) {
+        return columnTypes;
+    }
+
+    // Columns whose types are inferred
+    std::vector<int> inferredColumns;
+    for (const FilterDefinition& filterDefinition : query.filterDefinitions) {
+        auto it = std::find(headerColumns.begin(), headerColumns.end(), filterDefinition.columnName);
+        if (it != headerColumns.end() && !typeSet[it - headerColumns.begin()]) {
+            inferredColumns.push_back(it - headerColumns.begin());
+            typeSet[it - headerColumns.begin()] = true;
+        }
+    }
+    // The minimum and the maximum are also compared with the type of their column
+    for (const AggregateDefinition& aggregateDefinition : query.aggregateDefinitions) {
+        auto it = std::find(headerColumns.begin(), headerColumns.end(), aggregateDefinition.columnName);
+        bool compared = aggregateDefinition.function == AggregateFunction::Minimum || aggregateDefinition.function == AggregateFunction::Maximum;
+        if (compared && it != headerColumns.end() && !typeSet[it - headerColumns.begin()]) {
+            inferredColumns.push_back(it - headerColumns.begin());
+            typeSet[it - headerColumns.begin()] = true;
+        }
+    }
+    if (inferredColumns.empty()) {
+        return columnTypes;
+    }
+
+    // Collecting the values of the sample. The last row may be incomplete, so it's left out if there's more than one row
+    bool quoted = query.quoteMode != QuoteMode::None;
+    const char* sampleEnd = findLastRowEnd(sample.data(), sample.data() + sample.size(), quoted);
+    if (sampleEnd == sample.data()) sampleEnd = sample.data() + sample.size();
+    size_t maxFields = *std::max_element(inferredColumns.begin(), inferredColumns.end()) + 1;
+    std::vector<std::vector<std::string>> values(inferredColumns.size());
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    size_t rows = 0;
+    forEachRow(sample.data(), sampleEnd, maxFields, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        if (rows++ >= kTypeSampleRows) return;
+        for (size_t i = 0; i < inferredColumns.size(); ++i) {
+            std::string_view field = fieldAt(row, inferredColumns[i]);
+            values[i].emplace_back(quoted ? unquoteField(field, scratch) : field);
+        }
+    });
+
+    for (size_t i = 0; i < inferredColumns.size(); ++i) {
+        ColumnType type = inferColumnType(std::vector<std::string_view>(values[i].begin(), values[i].end()));
+
+        for (const FilterDefinition& filterDefinition : query.filterDefinitions) {
+            Filter filter = {inferredColumns[i], filterDefinition.comparator, filterDefinition.value, type};
+            if (filterDefinition.validComparator && filterDefinition.columnName == headerColumns[inferredColumns[i]]
+                && !parseFilterValue(filter)) {
+                type = ColumnType::Text;
+            }
+        }
+        columnTypes[inferredColumns[i]] = type;
+    }
+    return columnTypes;
+}
+
+// Build the query plan based on the header line, the selected columns and the filter definitions.
+// The plan, and everything used to build it, is allocated in the arena, where the header line must have been copied
+// (the names in the plan are views of it)
+static QueryPlan buildQueryPlan(const CsvQuery& query, std::string_view headerLine, std::string_view sample, QueryArena& arena) {
+    QueryPlan plan(&arena);
+
+    plan.quoteMode = query.quoteMode;
+
+    // Spliting the headerLine by commas into views of it
+    std::pmr::vector<std::string_view> headerColumns(&arena);
+    std::pmr::vector<std::string_view> quotedHeaderColumns(&arena); // The header fields as written, only used with quoting
+    if (query.quoteMode == QuoteMode::None) {
+        forEachPart(headerLine, ',', [&](std::string_view column) {
+            headerColumns.push_back(column);
+        });
+    } else {
+        // The names can have commas, so the header is split as any other row and the names are compared without quotes
+        std::vector<std::string_view> fields;
+        std::string scratch;
+        bool unterminated = forEachRow(headerLine.data(), headerLine.data() + headerLine.size(), SIZE_MAX, true, fields,
+                                       [&](const std::vector<std::string_view>& row) {
+            for (std::string_view field : row) {
+                if (query.quoteMode == QuoteMode::Strict && !isValidQuotedField(field)) {
+                    throw std::runtime_error("Invalid quoted field: '" + std::string(field) + "'");
+                }
+                quotedHeaderColumns.push_back(field);
+                std::string_view name = unquoteField(field, scratch);
+                headerColumns.push_back(name.data() == scratch.data() ? arena.copy(name) : name);
+            }
+        });
+        if (unterminated && query.quoteMode == QuoteMode::Strict) {
+            throw std::runtime_error("Invalid quoted field: the CSV ends inside a quoted field");
+        }
+    }
+    // Names written in the output header
+    const std::pmr::vector<std::string_view>& outputColumns = query.quoteMode == QuoteMode::None ? headerColumns : quotedHeaderColumns;
+
+    // We'll store the header columns name and its index just if it's in the selectedColumns
+    // If selectedColumns is empty, we'll store all headers (or none in aggregation mode, where all the rows form one group)
+    std::pmr::vector<HeaderColumn>& headerColumnsToSelect = plan.headerColumnsToSelect; // Array to store the header columns name and its index
+    bool aggregating = !query.aggregateDefinitions.empty();
+    if (query.selectAllColumns && !aggregating) {
+        headerColumnsToSelect.reserve(headerColumns.size());
+        for(int i = 0; i < static_cast<int>(headerColumns.size()); i++){
+            headerColumnsToSelect.push_back({outputColumns[i], i});
+        }
+    } else if (!query.selectAllColumns) {
+        // Creating an unordered_map to store the header name and its index.
+        // It will be used to find the index of the selectedColumns with complexity O(1)
+        std::pmr::unordered_map<std::string_view, int> headerColumnIndexMap(headerColumns.size(), &arena);
+        for (int i = 0; i < static_cast<int>(headerColumns.size()); ++i) {
+            headerColumnIndexMap[headerColumns[i]] = i;
+        }
+
+        // We'll iterate over the selectedColumns with complexity O(n) where n is the number of selectedColumns
+        // The complexity time of this block is O(n) * O(1) = O(n)
+        headerColumnsToSelect.reserve(query.selectedColumns.size());
+        for (std::string_view column : query.selectedColumns) {
+            // Checking if the column is in the headerColumnIndexMap
+            auto it = headerColumnIndexMap.find(column); // find in an unordered_map has complexity O(1)
+            if (it != headerColumnIndexMap.end()) {
+                headerColumnsToSelect.push_back({outputColumns[it->second], it->second});
+            } else {
+                throw std::runtime_error("Header '" + std::string(column) + "' not found in CSV file/string");
+            }
+        }
+    }
+
+    // Before any processing, we need to sort the headerColumnsToSelect by the index
+    // Therefore, we'll have the selected columns in the correct order
+    // The std::sort has complexity O(n log n) where n is the number of selected columns
+    std::sort(headerColumnsToSelect.begin(), headerColumnsToSelect.end(), [](const HeaderColumn& a, const HeaderColumn& b) {
+        return a.index < b.index;
+    });
+
+    // Preprocessing the filters based on all columns.
+    // It's throw a error if a filter has a non-existent column
+    std::pmr::vector<ColumnType> columnTypes = resolveColumnTypes(query, headerColumns, sample, &arena);
+    plan.filters = preprocessFilters(headerColumns, query.filterDefinitions, columnTypes, &arena);
+    checkComparators(query, headerColumns, sample);
+
+    plan.aggregates.reserve(query.aggregateDefinitions.size());
+    for (const AggregateDefinition& aggregateDefinition : query.aggregateDefinitions) {
+        int columnIndex = -1;
+        ColumnType type = ColumnType::Text;
+        if (!aggregateDefinition.columnName.empty()) {
+            auto it = std::find(headerColumns.begin(), headerColumns.end(), aggregateDefinition.columnName);
+            if (it == headerColumns.end()) {
+                throw std::runtime_error("Header '" + std::string(aggregateDefinition.columnName) + "' not found in CSV file/string");
+            }
+            columnIndex = it - headerColumns.begin();
+            type = columnTypes[columnIndex];
+        }
+        plan.aggregates.push_back({aggregateDefinition.function, columnIndex, type, aggregateDefinition.text});
+    }
+
+    // The fields after the last one used are never split, so rows with many columns are processed faster
+    plan.fieldsNeeded = 0;
+    if (!headerColumnsToSelect.empty()) {
+        plan.fieldsNeeded = headerColumnsToSelect.back().index + 1;
+    }
+    for (const FilterGroup& group : plan.filters.groups) {
+        plan.fieldsNeeded = std::max<size_t>(plan.fieldsNeeded, group.columnIndex + 1);
+    }
+    for (const Aggregate& aggregate : plan.aggregates) {
+        plan.fieldsNeeded = std::max<size_t>(plan.fieldsNeeded, aggregate.columnIndex + 1);
+    }
+
+    return plan;
+}
+
+const QueryPlan& bindQuery(CsvQuery& query, std::string_view headerColumnsLine, std::string_view sample) {
+    if (!query.bound || query.boundHeader != headerColumnsLine) {
+        // If the header is invalid for the query, the query stays unbound.
+        // The previous plan is dropped before its arena is released, so the plan of a prepared query doesn't grow
+        query.bound = false;
+        QueryArena& arena = query.planStorage();
+        query.plan = QueryPlan(&arena);
+        if (!query.transient) arena.release();
+
+        std::string_view header = arena.copy(headerColumnsLine);
+        query.plan = buildQueryPlan(query, header, sample, arena);
+        query.boundHeader = header;
+        // A plan with an invalid comparator is built again for the next input, which may have rows
+        query.bound = std::all_of(query.filterDefinitions.begin(), query.filterDefinitions.end(),
+                                  [](const FilterDefinition& filterDefinition) { return filterDefinition.validComparator; });
+    }
+    return query.plan;
+}
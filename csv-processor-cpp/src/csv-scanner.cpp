@@ -0,0 +1,239 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "../includes/csv-scanner.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_SCANNER_X86
+#endif
+
+// Prefix XOR of the bits: the bit i of the result is the XOR of the bits [0, i]. Each step doubles the span
+// already XORed, so 6 shifts cover the 64 bits
+static inline uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Byte by byte scanner. It's used when the CPU has no vector instructions and it's the reference for the others
+BlockMasks scanBlockScalar(const char* block) {
+    BlockMasks masks{};
+    for (size_t i = 0; i < kScanBlockSize; ++i) {
+        masks.commas |= static_cast<uint64_t>(block[i] == ',') << i;
+        masks.newlines |= static_cast<uint64_t>(block[i] == '\n') << i;
+        masks.quotes |= static_cast<uint64_t>(block[i] == '"') << i;
+    }
+    masks.quoteRegions = prefixXor(masks.quotes);
+    return masks;
+}
+
+#ifdef CSV_SCANNER_X86
+
+// SSE2 is part of every x86-64 CPU, so this is the baseline. It compares 16 bytes at a time
+BlockMasks scanBlockSse2(const char* block) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i quote = _mm_set1_epi8('"');
+
+    BlockMasks masks{};
+    for (size_t i = 0; i < kScanBlockSize; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        uint64_t commas = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, comma)));
+        uint64_t newlines = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+        uint64_t quotes = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)));
+        masks.commas |= commas << i;
+        masks.newlines |= newlines << i;
+        masks.quotes |= quotes << i;
+    }
+    masks.quoteRegions = prefixXor(masks.quotes);
+    return masks;
+}
+
+// The carry-less multiplication by a value with all bits set XORs each bit into every bit above it,
+// so it computes the prefix XOR with a single instruction
+__attribute__((target("pclmul")))
+static inline uint64_t prefixXorClmul(uint64_t bits) {
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(bits)), _mm_set1_epi8(-1), 0);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+}
+
+// AVX2 compares 32 bytes at a time
+__attribute__((target("avx2,pclmul")))
+BlockMasks scanBlockAvx2(const char* block) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i quote = _mm256_set1_epi8('"');
+
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+    BlockMasks masks;
+    masks.commas = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, comma)))
+        | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, comma)))) << 32;
+    masks.newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)))
+        | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)))) << 32;
+    masks.quotes = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, quote)))
+        | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, quote)))) << 32;
+    masks.quoteRegions = prefixXorClmul(masks.quotes);
+    return masks;
+}
+
+// AVX-512 (with the byte/word extension) compares the whole block at once and produces the masks directly
+__attribute__((target("avx512f,avx512bw,pclmul")))
+BlockMasks scanBlockAvx512(const char* block) {
+    __m512i bytes = _mm512_loadu_si512(block);
+
+    BlockMasks masks;
+    masks.commas = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(','));
+    masks.newlines = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\n'));
+    masks.quotes = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('"'));
+    masks.quoteRegions = prefixXorClmul(masks.quotes);
+    return masks;
+}
+
+#endif
+
+bool isScanLevelSupported(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::Scalar:
+            return true;
+#ifdef CSV_SCANNER_X86
+        case ScanLevel::Sse2:
+            return __builtin_cpu_supports("sse2");
+        case ScanLevel::Avx2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul");
+        case ScanLevel::Avx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("pclmul");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Returns the scanner of the level. The level must be supported by the CPU
+static ScanBlockFunction scanBlockFunctionFor(ScanLevel level) {
+    switch (level) {
+#ifdef CSV_SCANNER_X86
+        case ScanLevel::Sse2:
+            return scanBlockSse2;
+        case ScanLevel::Avx2:
+            return scanBlockAvx2;
+        case ScanLevel::Avx512:
+            return scanBlockAvx512;
+#endif
+        default:
+            return scanBlockScalar;
+    }
+}
+
+bool parseScanLevel(const char name[], ScanLevel& level) {
+    const struct { const char* name; ScanLevel level; } levels[] = {
+        {"scalar", ScanLevel::Scalar},
+        {"sse2", ScanLevel::Sse2},
+        {"avx2", ScanLevel::Avx2},
+        {"avx512", ScanLevel::Avx512},
+    };
+    for (const auto& entry : levels) {
+        if (std::strcmp(name, entry.name) == 0) {
+            level = entry.level;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Picks the fastest level supported by the CPU, or the one in the CSV_PROCESSOR_SIMD environment variable if it's supported
+static ScanBlockFunction detectScanBlockFunction() {
+    const char* requested = std::getenv("CSV_PROCESSOR_SIMD");
+    ScanLevel requestedLevel;
+    if (requested != nullptr && parseScanLevel(requested, requestedLevel) && isScanLevelSupported(requestedLevel)) {
+        return scanBlockFunctionFor(requestedLevel);
+    }
+
+    for (ScanLevel level : {ScanLevel::Avx512, ScanLevel::Avx2, ScanLevel::Sse2}) {
+        if (isScanLevelSupported(level)) {
+            return scanBlockFunctionFor(level);
+        }
+    }
+    return scanBlockScalar;
+}
+
+// The scanner is shared by every call, so it's atomic to allow setScanLevel while other threads are scanning
+static std::atomic<ScanBlockFunction> currentScanBlockFunction{nullptr};
+
+ScanBlockFunction getScanBlockFunction() {
+    ScanBlockFunction function = currentScanBlockFunction.load(std::memory_order_relaxed);
+    if (function == nullptr) {
+        // If another thread selected a scanner in the meantime, we keep its choice
+        ScanBlockFunction detected = detectScanBlockFunction();
+        if (currentScanBlockFunction.compare_exchange_strong(function, detected, std::memory_order_relaxed)) {
+            function = detected;
+        }
+    }
+    return function;
+}
+
+bool setScanLevel(ScanLevel level) {
+    if (!isScanLevelSupported(level)) {
+        return false;
+    }
+    currentScanBlockFunction.store(scanBlockFunctionFor(level), std::memory_order_relaxed);
+    return true;
+}
+
+void resetScanLevel() {
+    currentScanBlockFunction.store(nullptr, std::memory_order_relaxed);
+}
+
+const char* findRowEnd(const char* begin, const char* from, const char* end, bool quoted) {
+    if (!quoted) {
+        const char* newline = static_cast<const char*>(std::memchr(from, '\n', end - from));
+        return newline != nullptr ? newline + 1 : end;
+    }
+
+    // Whether from is inside a quoted field depends on how many quotes there are since the start of the row
+    ScanBlockFunction scanBlock = getScanBlockFunction();
+    uint64_t insideQuotes = 0;
+    const char* block = begin;
+    for (; block + kScanBlockSize <= from; block += kScanBlockSize) {
+        if (__builtin_popcountll(scanBlock(block).quotes) & 1) insideQuotes = ~insideQuotes;
+    }
+
+    // The block containing from is scanned from its start, and the newlines before from are ignored
+    for (bool first = true; block < end; block += kScanBlockSize, first = false) {
+        BlockMasks masks = scanBlockWithin(scanBlock, block, end);
+        maskQuotedCharacters(masks, insideQuotes);
+        if (first && from > block) masks.newlines &= ~0ULL << (from - block);
+        if (masks.newlines != 0) {
+            return block + __builtin_ctzll(masks.newlines) + 1;
+        }
+    }
+    return end;
+}
+
+const char* findLastRowEnd(const char* begin, const char* end, bool quoted) {
+    if (!quoted) {
+        for (const char* p = end; p > begin; --p) {
+            if (p[-1] == '\n') return p;
+        }
+        return begin;
+    }
+
+    // The quoted fields can only be found from the start, so the last newline outside them is the last one seen
+    ScanBlockFunction scanBlock = getScanBlockFunction();
+    uint64_t insideQuotes = 0;
+    const char* rowEnd = begin;
+    for (const char* block = begin; block < end; block += kScanBlockSize) {
+        BlockMasks masks = scanBlockWithin(scanBlock, block, end);
+        maskQuotedCharacters(masks, insideQuotes);
+        if (masks.newlines != 0) {
+            rowEnd = block + (63 - __builtin_clzll(masks.newlines)) + 1;
+        }
+    }
+    return rowEnd;
+}
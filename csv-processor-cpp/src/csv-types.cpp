@@ -0,0 +1,111 @@
+#include "../includes/csv-types.hpp"
+
+// Parse exactly digits decimal digits at the beginning of text. Returns false if there aren't enough digits
+static bool parseDigits(std::string_view text, size_t digits, int& value) {
+    if (text.size() < digits) return false;
+    value = 0;
+    for (size_t i = 0; i < digits; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+// Days since 1970-01-01 of a date of the proleptic Gregorian calendar. The years start in March,
+// so the leap day is the last day of the year and the days of each month follow a fixed formula
+static int64_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static int daysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leapYear ? 29 : days[month - 1];
+}
+
+bool parseDateField(std::string_view field, int64_t& value) {
+    // Date: YYYY-MM-DD
+    int year, month, day;
+    if (field.size() < 10 || !parseDigits(field, 4, year) || field[4] != '-' || !parseDigits(field.substr(5), 2, month)
+        || field[7] != '-' || !parseDigits(field.substr(8), 2, day)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+        return false;
+    }
+    int64_t microseconds = daysFromCivil(year, month, day) * 86400LL * 1000000;
+    field.remove_prefix(10);
+    if (field.empty()) {
+        value = microseconds;
+        return true;
+    }
+
+    // Time: THH:MM, THH:MM:SS or THH:MM:SS.fraction. A space can be used instead of the 'T'
+    int hour, minute, second = 0;
+    if ((field[0] != 'T' && field[0] != ' ') || !parseDigits(field.substr(1), 2, hour) || field.size() < 6 || field[3] != ':'
+        || !parseDigits(field.substr(4), 2, minute) || hour > 23 || minute > 59) {
+        return false;
+    }
+    field.remove_prefix(6);
+    if (!field.empty() && field[0] == ':') {
+        if (!parseDigits(field.substr(1), 2, second) || second > 60) return false;
+        field.remove_prefix(3);
+
+        // Only the first 6 digits of the fraction are kept
+        if (!field.empty() && field[0] == '.') {
+            size_t digits = 1;
+            int64_t scale = 100000;
+            int64_t fraction = 0;
+            while (digits < field.size() && field[digits] >= '0' && field[digits] <= '9') {
+                fraction += (field[digits] - '0') * scale;
+                scale /= 10;
+                ++digits;
+            }
+            if (digits == 1) return false;
+            microseconds += fraction;
+            field.remove_prefix(digits);
+        }
+    }
+    microseconds += ((hour * 60LL + minute) * 60 + second) * 1000000;
+
+    // Offset: Z, +HH:MM, -HH:MM, +HHMM or -HHMM. The timestamp is converted to UTC
+    if (field.empty() || field == "Z") {
+        value = microseconds;
+        return true;
+    }
+    int offsetHours, offsetMinutes;
+    size_t minutesStart = field.size() == 6 && field[3] == ':' ? 4 : 3;
+    if ((field[0] != '+' && field[0] != '-') || field.size() != minutesStart + 2 || !parseDigits(field.substr(1), 2, offsetHours)
+        || !parseDigits(field.substr(minutesStart), 2, offsetMinutes) || offsetHours > 23 || offsetMinutes > 59) {
+        return false;
+    }
+    int64_t offset = (offsetHours * 60LL + offsetMinutes) * 60 * 1000000;
+    value = field[0] == '+' ? microseconds - offset : microseconds + offset;
+    return true;
+}
+
+ColumnType inferColumnType(const std::vector<std::string_view>& sample) {
+    bool integer = true, floatingPoint = true, date = true, anyValue = false;
+    for (std::string_view field : sample) {
+        if (field.empty()) continue;
+        anyValue = true;
+
+        int64_t integerValue;
+        double floatValue;
+        integer = integer && parseIntegerField(field, integerValue);
+        floatingPoint = floatingPoint && (integer || parseFloatField(field, floatValue));
+        date = date && parseDateField(field, integerValue);
+        if (!integer && !floatingPoint && !date) break;
+    }
+
+    if (!anyValue) return ColumnType::Text;
+    if (integer) return ColumnType::Integer;
+    if (floatingPoint) return ColumnType::Float;
+    if (date) return ColumnType::Date;
+    return ColumnType::Text;
+}
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include "../includes/pipeline.hpp"
+#include "../includes/csv-scanner.hpp"
+
+// How long a read waits for data before checking again if the reader was cancelled (e.g. a pipe with no writer activity)
+static const int kReadPollMilliseconds = 10;
+
+ChunkReader::ChunkReader(int fd, size_t chunkSize, bool quoted, std::string_view pending, size_t readAhead)
+    : fd(fd), chunkSize(chunkSize), quoted(quoted), readAhead(std::min(readAhead, kPipelineDepth)) {
+    thread = std::thread(&ChunkReader::readLoop, this, std::string(pending));
+}
+
+ChunkReader::~ChunkReader() {
+    cancelled.store(true, std::memory_order_relaxed);
+    filled.wake();
+    free.wake();
+    thread.join();
+}
+
+bool ChunkReader::next(std::string_view& chunk) {
+    if (finished) {
+        if (current.error != 0) throw ReadError(current.error);
+        return false;
+    }
+    if (!current.data.empty()) {
+        // If the ring is full, the chunk is simply released
+        free.tryPush(current);
+    }
+
+    Backoff backoff;
+    while (!filled.tryPop(current)) {
+        backoff.wait(filled, [this] { return !filled.isEmpty(); });
+    }
+    finished = current.last;
+    chunk = std::string_view(current.data.data(), current.size);
+    return true;
+}
+
+// Read until the chunk is full or the input is over. Returns false once the input is over, or a read failed
+// (its errno is stored in the chunk)
+bool ChunkReader::readInto(Chunk& chunk, size_t& filledSize) {
+    while (filledSize < chunk.data.size()) {
+        if (cancelled.load(std::memory_order_relaxed)) return false;
+
+        // Waiting for data with a timeout, so a cancelled reader never stays blocked in a read
+        pollfd request = {fd, POLLIN, 0};
+        int ready = poll(&request, 1, kReadPollMilliseconds);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+
+        ssize_t bytesRead = read(fd, chunk.data.data() + filledSize, chunk.data.size() - filledSize);
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead < 0) chunk.error = errno;
+        if (bytesRead <= 0) return false;
+        filledSize += bytesRead;
+    }
+    return true;
+}
+
+void ChunkReader::readLoop(std::string carry) {
+    size_t allocated = 0;
+    bool endOfFile = false;
+    Backoff backoff;
+    while (!endOfFile && !cancelled.load(std::memory_order_relaxed)) {
+        // Reusing a processed chunk, or allocating a new one while there are fewer than the chunks read ahead
+        // (plus the one being processed)
+        Chunk chunk;
+        if (!free.tryPop(chunk)) {
+            if (allocated < readAhead + 1) {
+                ++allocated;
+            } else {
+                backoff.wait(free, [this] { return !free.isEmpty() || cancelled.load(std::memory_order_relaxed); });
+                continue;
+            }
+        }
+        backoff.reset();
+
+        // The row that crossed the end of the previous chunk goes first
+        if (chunk.data.size() < std::max(chunkSize, carry.size() * 2)) {
+            chunk.data.resize(std::max(chunkSize, carry.size() * 2));
+        }
+        std::memcpy(chunk.data.data(), carry.data(), carry.size());
+        size_t filledSize = carry.size();
+        chunk.error = 0;
+
+        // Reading until the chunk has at least one complete row. If a single row is bigger than the chunk, it grows to fit it.
+        // After a failed read, the row that was being read is incomplete, so it's left out
+        const char* rowsEnd;
+        while (true) {
+            endOfFile = !readInto(chunk, filledSize);
+            rowsEnd = endOfFile && chunk.error == 0 ? chunk.data.data() + filledSize
+                                                    : findLastRowEnd(chunk.data.data(), chunk.data.data() + filledSize, quoted);
+            if (endOfFile || rowsEnd != chunk.data.data()) break;
+            chunk.data.resize(chunk.data.size() * 2);
+        }
+        chunk.size = rowsEnd - chunk.data.data();
+        chunk.last = endOfFile;
+        carry.assign(rowsEnd, chunk.data.data() + filledSize - rowsEnd);
+
+        while (!filled.tryPush(chunk)) {
+            if (cancelled.load(std::memory_order_relaxed)) return;
+            backoff.wait(filled, [this] { return !filled.isFull() || cancelled.load(std::memory_order_relaxed); });
+        }
+        backoff.reset();
+    }
+}
+
+OutputWriter::OutputWriter(std::function<void(const char*, size_t)> writeData) : writeData(std::move(writeData)) {
+    thread = std::thread(&OutputWriter::writeLoop, this);
+}
+
+OutputWriter::~OutputWriter() {
+    closing.store(true, std::memory_order_release);
+    pending.wake();
+    thread.join();
+}
+
+void OutputWriter::write(std::string& data) {
+    Backoff backoff;
+    while (!pending.tryPush(data)) {
+        backoff.wait(pending, [this] { return !pending.isFull(); });
+    }
+    data.clear();
+    written.tryPop(data);
+}
+
+void OutputWriter::writeLoop() {
+    std::string data;
+    Backoff backoff;
+    while (true) {
+        // Every buffer queued before closing was set is visible once closing is, so the ring is drained before leaving
+        bool closed = closing.load(std::memory_order_acquire);
+        if (pending.tryPop(data)) {
+            writeData(data.data(), data.size());
+            data.clear();
+            written.tryPush(data);
+            backoff.reset();
+        } else if (closed) {
+            break;
+        } else {
+            backoff.wait(pending, [this] { return !pending.isEmpty() || closing.load(std::memory_order_acquire); });
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include "../includes/query-arena.hpp"
+
+// Block of the thread, shared by the arenas of its transient queries one at a time
+struct ThreadArenaBlock
+{
+    std::unique_ptr<char[]> data;
+    bool inUse = false;
+};
+
+static thread_local ThreadArenaBlock threadArenaBlock;
+
+// Returns the first position at or after the pointer that has the alignment
+static char* alignUp(char* pointer, size_t alignment) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    return reinterpret_cast<char*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+void QueryArena::release() {
+    while (lastBlock != nullptr) {
+        HeapBlock* previous = lastBlock->previous;
+        ::operator delete(lastBlock);
+        lastBlock = previous;
+    }
+    if (hasThreadBlock) {
+        threadArenaBlock.inUse = false;
+        hasThreadBlock = false;
+    }
+    cursor = nullptr;
+    end = nullptr;
+    nextBlockSize = kFirstArenaBlockSize;
+}
+
+std::string_view QueryArena::copy(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+void* QueryArena::do_allocate(size_t bytes, size_t alignment) {
+#ifdef CSV_DEBUG_STATS
+    ++allocations;
+#endif
+    char* data = alignUp(cursor, alignment);
+    if (cursor == nullptr || static_cast<size_t>(end - data) < bytes) {
+        return allocateInNewBlock(bytes, alignment);
+    }
+    cursor = data + bytes;
+    return data;
+}
+
+// Move to the block of the thread (the first time, if it's free) or to a new block from the heap big enough for the allocation
+void* QueryArena::allocateInNewBlock(size_t bytes, size_t alignment) {
+    if (useThreadBlock && !hasThreadBlock && lastBlock == nullptr && !threadArenaBlock.inUse
+        && bytes + alignment <= kThreadArenaBlockSize) {
+        if (!threadArenaBlock.data) threadArenaBlock.data.reset(new char[kThreadArenaBlockSize]);
+        threadArenaBlock.inUse = true;
+        hasThreadBlock = true;
+        cursor = threadArenaBlock.data.get();
+        end = cursor + kThreadArenaBlockSize;
+    } else {
+        size_t size = std::max(nextBlockSize, sizeof(HeapBlock) + bytes + alignment);
+        HeapBlock* block = static_cast<HeapBlock*>(::operator new(size));
+        block->previous = lastBlock;
+        lastBlock = block;
+        nextBlockSize = size * 2;
+        cursor = reinterpret_cast<char*>(block) + sizeof(HeapBlock);
+        end = reinterpret_cast<char*>(block) + size;
+#ifdef CSV_DEBUG_STATS
+        ++heapBlocks;
+#endif
+    }
+
+    char* data = alignUp(cursor, alignment);
+    cursor = data + bytes;
+    return data;
+}
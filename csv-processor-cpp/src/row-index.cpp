@@ -0,0 +1,88 @@
+#include <cstring>
+#include "../includes/row-index.hpp"
+#include "../includes/csv-scanner.hpp"
+#include "../includes/sidecar.hpp"
+
+// Identifies the row index files and the version of their format
+static const char kRowIndexMagic[8] = {'C', 'S', 'V', 'R', 'I', 'D', 'X', '1'};
+
+// Header of the row index file. It's followed by entryCount offsets of 64 bits
+struct RowIndexFileHeader
+{
+    char magic[8];
+    SidecarStamp stamp;
+    uint64_t rowsPerEntry;
+    uint64_t rowCount;
+    uint64_t quoted;
+    uint64_t entryCount;
+};
+
+std::string rowIndexPath(const char csvFilePath[]) {
+    return std::string(csvFilePath) + ".idx";
+}
+
+RowIndex buildRowIndex(const char* data, size_t size, size_t rowsPerEntry, bool quoted) {
+    RowIndex index;
+    index.rowsPerEntry = rowsPerEntry > 0 ? rowsPerEntry : kDefaultRowsPerEntry;
+    index.quoted = quoted;
+
+    const char* end = data + size;
+    const char* rowsBegin = findRowEnd(data, data, end, quoted);
+    if (rowsBegin == end) {
+        return index;
+    }
+
+    // Every '\n' (except the last byte of the file) starts a row, and the first row starts after the header
+    index.offsets.push_back(rowsBegin - data);
+    index.rowCount = 1;
+    forEachRowEnd(rowsBegin, end, quoted, [&](const char* rowStart) {
+        if (rowStart == end) return;
+        if (index.rowCount % index.rowsPerEntry == 0) {
+            index.offsets.push_back(rowStart - data);
+        }
+        ++index.rowCount;
+    });
+    return index;
+}
+
+bool writeRowIndex(const std::string& path, const RowIndex& index, const struct stat& csvFileStat, const char* data, size_t size) {
+    RowIndexFileHeader header = {};
+    std::memcpy(header.magic, kRowIndexMagic, sizeof(kRowIndexMagic));
+    header.stamp = makeSidecarStamp(csvFileStat, data, size, index.quoted);
+    header.rowsPerEntry = index.rowsPerEntry;
+    header.rowCount = index.rowCount;
+    header.quoted = index.quoted;
+    header.entryCount = index.offsets.size();
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(index.offsets.data()), index.offsets.size() * sizeof(uint64_t));
+    return writeSidecarFile(path, contents);
+}
+
+bool loadRowIndex(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size, RowIndex& index) {
+    std::string contents;
+    RowIndexFileHeader header;
+    if (!readSidecarFile(path, contents) || contents.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, contents.data(), sizeof(header));
+
+    bool valid = std::memcmp(header.magic, kRowIndexMagic, sizeof(kRowIndexMagic)) == 0
+        && isSidecarStampFresh(header.stamp, csvFileStat, data, size)
+        && header.rowsPerEntry > 0 && header.entryCount == (header.rowCount + header.rowsPerEntry - 1) / header.rowsPerEntry
+        && contents.size() == sizeof(header) + header.entryCount * sizeof(uint64_t);
+    if (!valid) {
+        return false;
+    }
+    index.rowsPerEntry = header.rowsPerEntry;
+    index.rowCount = header.rowCount;
+    index.quoted = header.quoted != 0;
+    index.offsets.resize(header.entryCount);
+    std::memcpy(index.offsets.data(), contents.data() + sizeof(header), header.entryCount * sizeof(uint64_t));
+
+    // The offsets must be row starts inside the file, in order
+    for (size_t i = 0; valid && i < index.offsets.size(); ++i) {
+        valid = index.offsets[i] >= header.stamp.headerSize && index.offsets[i] < size && (i == 0 || index.offsets[i] > index.offsets[i - 1]);
+    }
+    return valid;
+}
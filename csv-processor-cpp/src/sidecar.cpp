@@ -0,0 +1,81 @@
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../includes/sidecar.hpp"
+#include "../includes/csv-scanner.hpp"
+
+// 64 bits FNV-1a hash
+static uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+SidecarStamp makeSidecarStamp(const struct stat& csvFileStat, const char* data, size_t size, bool quoted) {
+    SidecarStamp stamp;
+    stamp.csvSize = static_cast<uint64_t>(csvFileStat.st_size);
+    stamp.modificationSeconds = csvFileStat.st_mtim.tv_sec;
+    stamp.modificationNanoseconds = csvFileStat.st_mtim.tv_nsec;
+    stamp.headerSize = findRowEnd(data, data, data + size, quoted) - data;
+    stamp.headerChecksum = checksum(data, stamp.headerSize);
+    return stamp;
+}
+
+bool isSidecarStampFresh(const SidecarStamp& stamp, const struct stat& csvFileStat, const char* data, size_t size) {
+    return stamp.csvSize == static_cast<uint64_t>(csvFileStat.st_size) && stamp.csvSize == size
+        && stamp.modificationSeconds == csvFileStat.st_mtim.tv_sec
+        && stamp.modificationNanoseconds == csvFileStat.st_mtim.tv_nsec
+        && stamp.headerSize <= size && stamp.headerChecksum == checksum(data, stamp.headerSize);
+}
+
+bool writeSidecarFile(const std::string& path, const std::string& contents) {
+    std::string temporaryPath = path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char* data = contents.data();
+    size_t size = contents.size();
+    bool written = true;
+    while (size > 0 && written) {
+        ssize_t bytesWritten = write(fd, data, size);
+        if (bytesWritten < 0 && errno == EINTR) continue;
+        written = bytesWritten > 0;
+        if (written) {
+            data += bytesWritten;
+            size -= bytesWritten;
+        }
+    }
+    written = close(fd) == 0 && written;
+    if (!written || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSidecarFile(const std::string& path, std::string& contents) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    contents.clear();
+    char buffer[1 << 16];
+    bool valid = true;
+    while (true) {
+        ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead <= 0) {
+            valid = bytesRead == 0;
+            break;
+        }
+        contents.append(buffer, bytesRead);
+    }
+    close(fd);
+    return valid;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstdlib>
+#include "../includes/thread-pool.hpp"
+
+ThreadPool::ThreadPool(int threadCount) : deques(new TaskDeque[threadCount > 1 ? threadCount : 1]) {
+    for (int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+static uint64_t packRange(uint64_t begin, uint64_t end) {
+    return begin << 32 | end;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    {
+        // A worker that woke up late for the previous parallelFor may still be looking for tasks.
+        // It has to stop before the counter is reset, or it could take a task of this call using the old counter
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return activeWorkers == 0; });
+        currentTask = &task;
+        pendingTasks = count;
+
+        // Each thread starts with a contiguous range of tasks, so the rows it processes are contiguous too
+        size_t threadCount = size();
+        for (size_t i = 0; i < threadCount; ++i) {
+            deques[i].range.store(packRange(count * i / threadCount, count * (i + 1) / threadCount), std::memory_order_relaxed);
+        }
+        error = nullptr;
+        ++generation;
+    }
+    wakeUp.notify_all();
+
+    runTasks(0);
+
+    // Waiting for the tasks taken by the workers
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return pendingTasks == 0; });
+    currentTask = nullptr;
+
+    // The exception of the first task that threw is thrown again in the caller
+    if (error) {
+        std::exception_ptr taskError = error;
+        error = nullptr;
+        std::rethrow_exception(taskError);
+    }
+}
+
+// Take the task at the front of the deque of the thread
+bool ThreadPool::popTask(size_t self, size_t& index) {
+    std::atomic<uint64_t>& range = deques[self].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (true) {
+        uint64_t begin = current >> 32;
+        uint64_t end = current & 0xFFFFFFFF;
+        if (begin >= end) return false;
+        if (range.compare_exchange_weak(current, packRange(begin + 1, end), std::memory_order_acq_rel)) {
+            index = begin;
+            return true;
+        }
+    }
+}
+
+// Take the back half of the tasks left to another thread. The first one is returned to be run,
+// and the rest go to the deque of the thread (which is empty, since it only steals once its tasks are over)
+bool ThreadPool::stealTasks(size_t self, size_t& index) {
+    size_t threadCount = size();
+    for (size_t i = 1; i < threadCount; ++i) {
+        std::atomic<uint64_t>& victim = deques[(self + i) % threadCount].range;
+        uint64_t current = victim.load(std::memory_order_acquire);
+        while (true) {
+            uint64_t begin = current >> 32;
+            uint64_t end = current & 0xFFFFFFFF;
+            if (begin >= end) break;
+            uint64_t stolenBegin = end - (end - begin + 1) / 2;
+            if (victim.compare_exchange_weak(current, packRange(begin, stolenBegin), std::memory_order_acq_rel)) {
+                index = stolenBegin;
+                deques[self].range.store(packRange(stolenBegin + 1, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Run tasks until no thread has any left. Every task runs once, since a task only leaves a deque
+// through the compare-and-swap that shrinks its range
+void ThreadPool::runTasks(size_t self) {
+    size_t index;
+    while (popTask(self, index) || stealTasks(self, index)) {
+        std::exception_ptr taskError;
+        try {
+            (*currentTask)(index);
+        } catch (...) {
+            taskError = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (taskError && (!error || index < errorIndex)) {
+            error = taskError;
+            errorIndex = index;
+        }
+        if (--pendingTasks == 0) finished.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(size_t self) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            ++activeWorkers;
+        }
+
+        runTasks(self);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) finished.notify_all();
+    }
+}
+
+static std::atomic<int> configuredThreadCount{0};
+
+int resolveThreadCount() {
+    int threadCount = configuredThreadCount.load(std::memory_order_relaxed);
+    if (threadCount <= 0) {
+        const char* environment = std::getenv("CSV_PROCESSOR_THREADS");
+        if (environment != nullptr) threadCount = std::atoi(environment);
+    }
+    if (threadCount <= 0) {
+        threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    return threadCount > 0 ? threadCount : 1;
+}
+
+void setThreadCount(int threadCount) {
+    configuredThreadCount.store(threadCount, std::memory_order_relaxed);
+}
+
+static std::mutex idlePoolsMutex;
+static std::vector<std::unique_ptr<ThreadPool>> idlePools;
+
+std::unique_ptr<ThreadPool> acquireThreadPool(int threadCount) {
+    // The pools of another size are destroyed after the lock is released, since joining their threads takes a while
+    std::vector<std::unique_ptr<ThreadPool>> stalePools;
+    std::unique_ptr<ThreadPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(idlePoolsMutex);
+        for (auto it = idlePools.begin(); it != idlePools.end();) {
+            if ((*it)->size() != std::max(threadCount, 1)) {
+                stalePools.push_back(std::move(*it));
+                it = idlePools.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!idlePools.empty()) {
+            pool = std::move(idlePools.back());
+            idlePools.pop_back();
+        }
+    }
+    if (!pool) pool.reset(new ThreadPool(threadCount));
+    return pool;
+}
+
+void releaseThreadPool(std::unique_ptr<ThreadPool> pool) {
+    if (pool->size() != resolveThreadCount()) return;
+    std::lock_guard<std::mutex> lock(idlePoolsMutex);
+    idlePools.push_back(std::move(pool));
+}
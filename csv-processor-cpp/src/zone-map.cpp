@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstring>
+#include "../includes/zone-map.hpp"
+#include "../includes/csv-scanner.hpp"
+#include "../includes/sidecar.hpp"
+
+// Identifies the zone map files and the version of their format
+static const char kZoneMapMagic[8] = {'C', 'S', 'V', 'Z', 'M', 'A', 'P', '1'};
+
+// Header of the zone map file. It's followed by the blocks: the offset of 64 bits, and for each column
+// the minimum and the maximum, each one as a length of 64 bits and the bytes of the value
+struct ZoneMapFileHeader
+{
+    char magic[8];
+    SidecarStamp stamp;
+    uint64_t rowsPerBlock;
+    uint64_t quoted;
+    uint64_t columnCount;
+    uint64_t blockCount;
+};
+
+std::string zoneMapPath(const char csvFilePath[]) {
+    return std::string(csvFilePath) + ".zmap";
+}
+
+ZoneMap buildZoneMap(const char* data, size_t size, size_t rowsPerBlock, bool quoted) {
+    ZoneMap zoneMap;
+    zoneMap.rowsPerBlock = rowsPerBlock > 0 ? rowsPerBlock : kDefaultRowsPerBlock;
+    zoneMap.quoted = quoted;
+
+    const char* end = data + size;
+    const char* rowsBegin = findRowEnd(data, data, end, quoted);
+    std::vector<std::string_view> fields;
+
+    // Counting the columns of the header. Each row keeps only this number of fields
+    size_t columnCount = 0;
+    forEachRow(data, rowsBegin, SIZE_MAX, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        if (columnCount == 0) columnCount = row.size();
+    });
+    columnCount = std::max<size_t>(columnCount, 1);
+
+    std::string scratch;
+    size_t rowInBlock = 0;
+    forEachRow(rowsBegin, end, columnCount, quoted, fields, [&](const std::vector<std::string_view>& row) {
+        // A row always has its first field, which starts where the row starts
+        bool firstRow = rowInBlock == 0;
+        if (firstRow) {
+            zoneMap.blocks.emplace_back();
+            zoneMap.blocks.back().offset = static_cast<uint64_t>(row[0].data() - data);
+            zoneMap.blocks.back().minimums.resize(columnCount);
+            zoneMap.blocks.back().maximums.resize(columnCount);
+        }
+        ZoneMapBlock& block = zoneMap.blocks.back();
+
+        for (size_t i = 0; i < columnCount; ++i) {
+            std::string_view value = fieldAt(row, i);
+            if (quoted) value = unquoteField(value, scratch);
+            if (firstRow || value < block.minimums[i]) block.minimums[i].assign(value);
+            if (firstRow || value > block.maximums[i]) block.maximums[i].assign(value);
+        }
+
+        if (++rowInBlock == zoneMap.rowsPerBlock) rowInBlock = 0;
+    });
+    return zoneMap;
+}
+
+// Append a number of 64 bits to the contents of a file
+static void appendNumber(std::string& contents, uint64_t number) {
+    contents.append(reinterpret_cast<const char*>(&number), sizeof(number));
+}
+
+// Read a number of 64 bits at the position of the contents, moving the position after it. Returns false if it's past the end
+static bool readNumber(const std::string& contents, size_t& position, uint64_t& number) {
+    if (contents.size() - position < sizeof(number)) return false;
+    std::memcpy(&number, contents.data() + position, sizeof(number));
+    position += sizeof(number);
+    return true;
+}
+
+// Read a value (its length and its bytes) at the position of the contents. Returns false if it's past the end
+static bool readValue(const std::string& contents, size_t& position, std::string& value) {
+    uint64_t length;
+    if (!readNumber(contents, position, length) || contents.size() - position < length) return false;
+    value.assign(contents, position, length);
+    position += length;
+    return true;
+}
+
+bool writeZoneMap(const std::string& path, const ZoneMap& zoneMap, const struct stat& csvFileStat, const char* data, size_t size) {
+    ZoneMapFileHeader header = {};
+    std::memcpy(header.magic, kZoneMapMagic, sizeof(kZoneMapMagic));
+    header.stamp = makeSidecarStamp(csvFileStat, data, size, zoneMap.quoted);
+    header.rowsPerBlock = zoneMap.rowsPerBlock;
+    header.quoted = zoneMap.quoted;
+    header.columnCount = zoneMap.blocks.empty() ? 0 : zoneMap.blocks.front().minimums.size();
+    header.blockCount = zoneMap.blocks.size();
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const ZoneMapBlock& block : zoneMap.blocks) {
+        appendNumber(contents, block.offset);
+        for (size_t i = 0; i < header.columnCount; ++i) {
+            appendNumber(contents, block.minimums[i].size());
+            contents.append(block.minimums[i]);
+            appendNumber(contents, block.maximums[i].size());
+            contents.append(block.maximums[i]);
+        }
+    }
+    return writeSidecarFile(path, contents);
+}
+
+bool loadZoneMap(const std::string& path, const struct stat& csvFileStat, const char* data, size_t size, ZoneMap& zoneMap) {
+    std::string contents;
+    ZoneMapFileHeader header;
+    if (!readSidecarFile(path, contents) || contents.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (std::memcmp(header.magic, kZoneMapMagic, sizeof(kZoneMapMagic)) != 0 || !isSidecarStampFresh(header.stamp, csvFileStat, data, size)
+        || header.rowsPerBlock == 0) {
+        return false;
+    }
+
+    zoneMap.rowsPerBlock = header.rowsPerBlock;
+    zoneMap.quoted = header.quoted != 0;
+    zoneMap.blocks.clear();
+    size_t position = sizeof(header);
+    for (uint64_t i = 0; i < header.blockCount; ++i) {
+        ZoneMapBlock block;
+        block.minimums.resize(header.columnCount);
+        block.maximums.resize(header.columnCount);
+        bool valid = readNumber(contents, position, block.offset) && block.offset >= header.stamp.headerSize && block.offset < size
+            && (zoneMap.blocks.empty() || block.offset > zoneMap.blocks.back().offset);
+        for (uint64_t column = 0; valid && column < header.columnCount; ++column) {
+            valid = readValue(contents, position, block.minimums[column]) && readValue(contents, position, block.maximums[column]);
+        }
+        if (!valid) {
+            return false;
+        }
+        zoneMap.blocks.push_back(std::move(block));
+    }
+    return position == contents.size();
+}
+
+// Check if any value in [minimum, maximum] satisfies the filter
+static bool rangeMaySatisfyFilter(std::string_view minimum, std::string_view maximum, const Filter& filter) {
+    std::string_view value = filter.value;
+    switch (filter.comparator) {
+        case Comparator::Greater:
+            return maximum > value;
+        case Comparator::Less:
+            return minimum < value;
+        case Comparator::Equal:
+            return minimum <= value && value <= maximum;
+        case Comparator::NotEqual:
+            return minimum != value || maximum != value;
+        case Comparator::GreaterEqual:
+            return maximum >= value;
+        case Comparator::LessEqual:
+            return minimum <= value;
+    }
+    return true;
+}
+
+bool blockMaySatisfyFilters(const ZoneMapBlock& block, const FilterPlan& plan) {
+    for (const FilterGroup& group : plan.groups) {
+        if (static_cast<size_t>(group.columnIndex) >= block.minimums.size()) {
+            continue;
+        }
+
+        bool groupMaySatisfy = false;
+        for (int i = group.begin; i < group.end && !groupMaySatisfy; ++i) {
+            const Filter& filter = plan.filters[i];
+            groupMaySatisfy = filter.type != ColumnType::Text
+                || rangeMaySatisfyFilter(block.minimums[group.columnIndex], block.maximums[group.columnIndex], filter);
+        }
+        if (!groupMaySatisfy) {
+            return false;
+        }
+    }
+    return true;
+}
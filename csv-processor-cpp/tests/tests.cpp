@@ -2,8 +2,15 @@
 
 #include "catch.hpp"
 #include "../includes/csv-processor.hpp"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 TEST_CASE("processCsv should return just the selectedColumns", "[test-1]" ) {
     // Storing the cout buffer
@@ -370,3 +377,1077 @@ TEST_CASE("processCsv should allow more than one filter for the same column", "[
 }
 
 
+TEST_CASE("processCsvFileStream should return the same result as processCsvFile", "[test-15]" ) {
+    // Tests variables
+    const char csvFilePath[] = "../data.csv";
+    const char selectedColumns[] = "col1,col3,col4,col7";
+    const char rowFilterDefinitions[] = "col1>l1c1\ncol3>l1c3";
+
+    SECTION("Default chunk size"){
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function
+        processCsvFileStream(csvFilePath, selectedColumns, rowFilterDefinitions, 0);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "col1,col3,col4,col7\nl2c1,l2c3,l2c4,l2c7\nl3c1,l3c3,l3c4,l3c7\n");
+    }
+
+    SECTION("Chunks smaller than a row"){
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function with 8 bytes chunks, so every row crosses a chunk boundary
+        processCsvFileStream(csvFilePath, selectedColumns, rowFilterDefinitions, 8);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "col1,col3,col4,col7\nl2c1,l2c3,l2c4,l2c7\nl3c1,l3c3,l3c4,l3c7\n");
+    }
+}
+
+TEST_CASE("processCsv should treat missing fields as empty", "[test-16]" ) {
+    // Storing the cout buffer
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+    // Tests variables
+    const char csv[] = "header1,header2,header3\n1,2\n4,5,6\n7";
+    const char selectedColumns[] = "";
+    const char rowFilterDefinitions[] = "header1>0\nheader3<9";
+
+    // Calling the shared object function
+    processCsv(csv, selectedColumns, rowFilterDefinitions);
+
+    // Restoring the cout buffer
+    std::cout.rdbuf(oldCout);
+
+    // Checking if the output is correct
+    REQUIRE(buffer.str() == "header1,header2,header3\n1,2,\n4,5,6\n7,,\n");
+}
+
+TEST_CASE("processCsv should return the same result with every scan level", "[test-17]" ) {
+    // Tests variables. The rows are wider than a 64 bytes scan block and the last one has no '\n'
+    std::string csv = "header1,header2,header3,header4\n";
+    for (int i = 0; i < 50; ++i) {
+        csv += std::to_string(i) + "," + std::string(i * 3, 'a') + "," + std::to_string(i % 7) + ",," + "\n";
+    }
+    csv += "last," + std::string(70, 'b') + ",5,x";
+    const char selectedColumns[] = "header4,header2,header1";
+    const char rowFilterDefinitions[] = "header3=5\nheader3=2\nheader1>3";
+
+    // The default level is restored at the end, even if a check fails, so the other tests run with it
+    struct ScanLevelGuard
+    {
+        ~ScanLevelGuard() { setCsvScanLevel("auto"); }
+    } scanLevelGuard;
+
+    // The scalar scan is the reference for the others
+    REQUIRE(setCsvScanLevel("scalar"));
+    std::stringstream expected;
+    std::streambuf* oldCout = std::cout.rdbuf(expected.rdbuf());
+    processCsv(csv.c_str(), selectedColumns, rowFilterDefinitions);
+    std::cout.rdbuf(oldCout);
+
+    for (const char* level : {"sse2", "avx2", "avx512"}) {
+        // Levels the CPU doesn't support can't be tested
+        if (!setCsvScanLevel(level)) continue;
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function
+        processCsv(csv.c_str(), selectedColumns, rowFilterDefinitions);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+
+        // Checking if the output is correct
+        INFO("Scan level: " << level);
+        REQUIRE(buffer.str() == expected.str());
+    }
+
+    REQUIRE_FALSE(setCsvScanLevel("mmx"));
+    REQUIRE(setCsvScanLevel("auto"));
+}
+
+TEST_CASE("processCsv shouldn't allow invalid comparators made of valid characters", "[test-18]" ) {
+    // Redirect cerr buffer
+    std::stringstream errStream;
+    std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+    // Tests variables
+    const char csv[] = "header1,header2,header3\n1,2,3\n4,5,6\n7,8,9";
+    const char selectedColumns[] = "header1,header3";
+
+    // As with the original parser, the message has the field of the first row instead of the column name
+    SECTION("After a valid filter"){
+        processCsv(csv, selectedColumns, "header3<8\nheader1=>2");
+        REQUIRE(errStream.str() == "Invalid filter: '1=>2'\n");
+    }
+
+    SECTION("Made of the same character"){
+        processCsv(csv, selectedColumns, "header3==2");
+        REQUIRE(errStream.str() == "Invalid filter: '3==2'\n");
+    }
+
+    // A column that doesn't exist is reported first, even if it comes after the invalid comparator
+    SECTION("Before a column that doesn't exist"){
+        processCsv(csv, selectedColumns, "header1<>2\nheader4=1");
+        REQUIRE(errStream.str() == "Header 'header4' not found in CSV file/string\n");
+    }
+
+    // A filter with only a comparator is reported as it is written
+    SECTION("Without a column"){
+        processCsv(csv, selectedColumns, "==");
+        REQUIRE(errStream.str() == "Invalid filter: '=='\n");
+    }
+
+    // Restore cerr
+    std::cerr.rdbuf(oldCerr);
+}
+
+TEST_CASE("processCsv should keep the rows in order when using many threads", "[test-19]" ) {
+    // Tests variables. The CSV is big enough (about 4 MB) to be split between the threads
+    std::string csv = "id,name,group\n";
+    for (int i = 0; i < 200000; ++i) {
+        csv += std::to_string(i) + ",name" + std::to_string(i) + "," + std::to_string(i % 10) + "\n";
+    }
+    const char selectedColumns[] = "id,group";
+    const char rowFilterDefinitions[] = "group=3\ngroup=7";
+
+    // The output of a single thread is the reference
+    setCsvThreadCount(1);
+    std::stringstream expected;
+    std::streambuf* oldCout = std::cout.rdbuf(expected.rdbuf());
+    processCsv(csv.c_str(), selectedColumns, rowFilterDefinitions);
+    std::cout.rdbuf(oldCout);
+
+    // Storing the cout buffer
+    std::stringstream buffer;
+    oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+    // Calling the shared object function
+    setCsvThreadCount(4);
+    processCsv(csv.c_str(), selectedColumns, rowFilterDefinitions);
+    setCsvThreadCount(0);
+
+    // Restoring the cout buffer
+    std::cout.rdbuf(oldCout);
+
+    // Checking if the output is correct
+    REQUIRE(expected.str().size() > 100000);
+    REQUIRE(buffer.str() == expected.str());
+}
+
+TEST_CASE("csvQueryRun should reuse a prepared query on many inputs", "[test-20]" ) {
+    CsvQuery* query = csvQueryPrepare("header1,header3", "header1>1\nheader3<8");
+    REQUIRE(query != nullptr);
+
+    SECTION("Inputs with the same header"){
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function
+        csvQueryRun(query, "header1,header2,header3\n1,2,3\n4,5,6\n7,8,9");
+        csvQueryRun(query, "header1,header2,header3\n2,2,2\n9,9,9");
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "header1,header3\n4,6\nheader1,header3\n2,2\n");
+    }
+
+    SECTION("Inputs with different headers"){
+        // Storing the cout and cerr buffers
+        std::stringstream buffer;
+        std::stringstream errStream;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+        std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+        // Calling the shared object function. The second header has the columns in another order and the third misses one
+        csvQueryRun(query, "header1,header2,header3\n4,5,6");
+        csvQueryRun(query, "header3,header1\n6,4");
+        csvQueryRun(query, "header1,header2\n4,5");
+        csvQueryRun(query, "header1,header2,header3\n5,5,5");
+
+        // Restoring the cout and cerr buffers
+        std::cout.rdbuf(oldCout);
+        std::cerr.rdbuf(oldCerr);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "header1,header3\n4,6\nheader3,header1\n6,4\nheader1,header3\n5,5\n");
+        REQUIRE(errStream.str() == "Header 'header3' not found in CSV file/string\n");
+    }
+
+    csvQueryFree(query);
+}
+
+TEST_CASE("processCsv shouldn't allow comparator characters in the filter values", "[test-21]" ) {
+    // Redirect cerr buffer
+    std::stringstream errStream;
+    std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+    // Tests variables
+    const char csv[] = "header1,header2,header3\n1,2,3\n4,5,6\n7,8,9";
+    const char selectedColumns[] = "header1,header3";
+    const char rowFilterDefinitions[] = "header1>1\nheader3<8=2";
+
+    // Calling the shared object function
+    processCsv(csv, selectedColumns, rowFilterDefinitions); 
+
+    // Restore cerr
+    std::cerr.rdbuf(oldCerr);
+
+    // Checking if the output is correct
+    REQUIRE(errStream.str() == "Invalid filter: 'header3<8=2'\n");
+}
+
+TEST_CASE("processCsvToSink should write the output in the sink instead of std::cout", "[test-22]" ) {
+    // Tests variables
+    const char csv[] = "header1,header2,header3\n1,2,3\n4,5,6\n7,8,9";
+    const char selectedColumns[] = "header1,header3";
+    const char rowFilterDefinitions[] = "header1>1\nheader3<8";
+
+    SECTION("Buffer sink"){
+        char output[64];
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+
+        // Calling the shared object function
+        processCsvToSink(csv, selectedColumns, rowFilterDefinitions, &sink);
+
+        // Checking if the output is correct
+        REQUIRE(std::string(output, sink.size) == "header1,header3\n4,6\n");
+    }
+
+    SECTION("Buffer sink smaller than the output"){
+        char output[8];
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+
+        // Calling the shared object function
+        processCsvToSink(csv, selectedColumns, rowFilterDefinitions, &sink);
+
+        // Checking if the output is truncated and the size is the size of the whole output
+        REQUIRE(sink.size == 20);
+        REQUIRE(std::string(output, sizeof(output)) == "header1,");
+    }
+
+    SECTION("Callback sink"){
+        std::string output;
+        CsvSink sink = csvCallbackSink([](void* context, const char* data, size_t size) {
+            static_cast<std::string*>(context)->append(data, size);
+        }, &output);
+
+        // Calling the shared object function
+        processCsvToSink(csv, selectedColumns, rowFilterDefinitions, &sink);
+
+        // Checking if the output is correct
+        REQUIRE(output == "header1,header3\n4,6\n");
+    }
+}
+
+TEST_CASE("processCsv should ignore the fields after the last column used", "[test-23]" ) {
+    // Storing the cout buffer
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+    // Tests variables. The rows have more fields than the header and some have fewer
+    const char csv[] = "h1,h2,h3,h4,h5\n1,a,x,x,x,x,x\n2,b\n3,a,x,x,x\n4\n5,a,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,";
+    const char selectedColumns[] = "h1";
+    const char rowFilterDefinitions[] = "h2=a";
+
+    // Calling the shared object function
+    processCsv(csv, selectedColumns, rowFilterDefinitions);
+
+    // Restoring the cout buffer
+    std::cout.rdbuf(oldCout);
+
+    // Checking if the output is correct
+    REQUIRE(buffer.str() == "h1\n1\n3\n5\n");
+}
+
+
+TEST_CASE("csvQueryRun should handle RFC 4180 quoted fields", "[test-24]" ) {
+    // Tests variables. The quoted fields have commas, newlines and escaped quotes
+    const char csv[] = "id,\"na,me\",city\n1,\"Smith, John\",Paris\n2,\"say \"\"hi\"\"\",\"New\nYork\"\n3,plain,Rome";
+
+    SECTION("Without quoting, the quotes are ordinary characters"){
+        CsvQuery* query = csvQueryPrepare("id", "id>1");
+        REQUIRE(query != nullptr);
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function
+        csvQueryRun(query, csv);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+        csvQueryFree(query);
+
+        // Checking if the output is correct. The newline inside the quotes ends a row
+        REQUIRE(buffer.str() == "id\n2\nYork\"\n3\n");
+    }
+
+    SECTION("Permissive mode"){
+        CsvQuery* query = csvQueryPrepare("", "na,me>say\nid!=3");
+        REQUIRE(query != nullptr);
+        csvQuerySetQuoteMode(query, CSV_QUOTES_PERMISSIVE);
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function
+        csvQueryRun(query, csv);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+        csvQueryFree(query);
+
+        // Checking if the output is correct. The values are compared without quotes and written as they were
+        REQUIRE(buffer.str() == "id,\"na,me\",city\n2,\"say \"\"hi\"\"\",\"New\nYork\"\n");
+    }
+
+    SECTION("Strict mode"){
+        CsvQuery* query = csvQueryPrepare("id", "city!=x");
+        REQUIRE(query != nullptr);
+        csvQuerySetQuoteMode(query, CSV_QUOTES_STRICT);
+
+        // Storing the cout and cerr buffers
+        std::stringstream buffer;
+        std::stringstream errStream;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+        std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+        // Calling the shared object function. The second input has a quote in the middle of a field
+        csvQueryRun(query, csv);
+        csvQueryRun(query, "id,city\n1,Par\"is\"\n");
+
+        // Restoring the cout and cerr buffers
+        std::cout.rdbuf(oldCout);
+        std::cerr.rdbuf(oldCerr);
+        csvQueryFree(query);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "id\n1\n2\n3\nid\n");
+        REQUIRE(errStream.str() == "Invalid quoted field: 'Par\"is\"'\n");
+    }
+}
+
+TEST_CASE("csvQueryRun should compare typed columns by value", "[test-25]" ) {
+    // Tests variables
+    const char csv[] = "id,amount,price,day\n9,9,1.5,2026-01-02\n10,10,1e1,2026-01-01T23:30:00-01:00\n11,x,,2025-12-31\n";
+
+    SECTION("Types set in the query"){
+        CsvQuery* integerQuery = csvQueryPrepare("id", "amount>9");
+        CsvQuery* floatQuery = csvQueryPrepare("id", "price>2");
+        REQUIRE(integerQuery != nullptr);
+        REQUIRE(floatQuery != nullptr);
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function. As text, "10" < "9" < "x" and "1e1" < "2"
+        csvQueryRun(integerQuery, csv);
+        csvQueryRun(floatQuery, csv);
+        REQUIRE(csvQuerySetColumnType(integerQuery, "amount", CSV_TYPE_INTEGER) == 1);
+        REQUIRE(csvQuerySetColumnType(floatQuery, "price", CSV_TYPE_FLOAT) == 1);
+        csvQueryRun(integerQuery, csv);
+        csvQueryRun(floatQuery, csv);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+        csvQueryFree(integerQuery);
+        csvQueryFree(floatQuery);
+
+        // Checking if the output is correct. Fields that aren't numbers don't satisfy typed filters
+        REQUIRE(buffer.str() == "id\n11\nid\nid\n10\nid\n10\n");
+    }
+
+    SECTION("Dates and timestamps"){
+        CsvQuery* query = csvQueryPrepare("id", "day>=2026-01-02");
+        REQUIRE(query != nullptr);
+        REQUIRE(csvQuerySetColumnType(query, "day", CSV_TYPE_DATE) == 1);
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function. 2026-01-01T23:30:00-01:00 is 2026-01-02T00:30:00Z
+        csvQueryRun(query, csv);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+        csvQueryFree(query);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "id\n9\n10\n");
+    }
+
+    SECTION("Types inferred from the first rows"){
+        CsvQuery* query = csvQueryPrepare("id", "id>9\namount>9");
+        REQUIRE(query != nullptr);
+        csvQueryInferTypes(query, 1);
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function. id is an integer column, but amount has a text value
+        csvQueryRun(query, csv);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+        csvQueryFree(query);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "id\n11\n");
+    }
+
+    SECTION("Signs and values that aren't numbers"){
+        const char signedCsv[] = "id,amount,price\n1,+5,+1.5\n2,+-5,+-1.5\n3,-+5,inf\n4,+,nan\n5,-5,-.5\n6,++5,-inf\n";
+        CsvQuery* integerQuery = csvQueryPrepare("id", "amount>-10");
+        CsvQuery* floatQuery = csvQueryPrepare("id", "price>-10");
+        REQUIRE(integerQuery != nullptr);
+        REQUIRE(floatQuery != nullptr);
+        REQUIRE(csvQuerySetColumnType(integerQuery, "amount", CSV_TYPE_INTEGER) == 1);
+        REQUIRE(csvQuerySetColumnType(floatQuery, "price", CSV_TYPE_FLOAT) == 1);
+
+        // Storing the cout buffer
+        std::stringstream buffer;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object function. Only a single leading sign is accepted, and inf and nan are text
+        csvQueryRun(integerQuery, signedCsv);
+        csvQueryRun(floatQuery, signedCsv);
+
+        // Restoring the cout buffer
+        std::cout.rdbuf(oldCout);
+        csvQueryFree(integerQuery);
+        csvQueryFree(floatQuery);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "id\n1\n5\n" "id\n1\n5\n");
+    }
+
+    SECTION("Invalid value for the type"){
+        CsvQuery* query = csvQueryPrepare("id", "amount>ten");
+        REQUIRE(query != nullptr);
+        REQUIRE(csvQuerySetColumnType(query, "amount", CSV_TYPE_INTEGER) == 1);
+
+        // Storing the cerr buffer
+        std::stringstream errStream;
+        std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+        // Calling the shared object function
+        csvQueryRun(query, csv);
+
+        // Restoring the cerr buffer
+        std::cerr.rdbuf(oldCerr);
+        csvQueryFree(query);
+
+        // Checking if the error is correct
+        REQUIRE(errStream.str() == "Invalid integer value in filter: 'amount' has the value 'ten'\n");
+    }
+}
+
+TEST_CASE("csvQueryRunFileRowsToSink should use the row index while it's fresh", "[test-26]" ) {
+    // Tests variables. The file is written by the test and removed at the end
+    const char path[] = "row-index-test.csv";
+    std::ofstream(path) << "header1,header2\n0,a\n1,b\n2,c\n3,d\n4,e\n";
+    CsvQuery* query = csvQueryPrepare("header1", "header2!=c");
+    REQUIRE(query != nullptr);
+
+    // Calling the shared object functions
+    REQUIRE(csvBuildRowIndex(path, 2, CSV_QUOTES_NONE) == 1);
+
+    char output[256];
+    CsvSink sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileRowsToSink(query, path, 1, 3, &sink);
+    REQUIRE(std::string(output, sink.size) == "header1\n1\n3\n");
+
+    // The file changed, so the stale index must be ignored
+    std::ofstream(path) << "header1,header2\n5,f\n6,g\n";
+    sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileRowsToSink(query, path, 1, 3, &sink);
+    REQUIRE(std::string(output, sink.size) == "header1\n6\n");
+
+    csvQueryFree(query);
+    std::remove(path);
+    std::remove((std::string(path) + ".idx").c_str());
+}
+
+TEST_CASE("csvQueryRunFile should skip the blocks of the zone map that can't match", "[test-27]" ) {
+    // Tests variables. The file is written by the test and removed at the end
+    const char path[] = "zone-map-test.csv";
+    std::ofstream(path) << "day,value\n2026-01-01,a\n2026-01-02,b\n2026-02-01,c\n2026-02-02,d\n2026-03-01,e\n";
+    CsvQuery* query = csvQueryPrepare("value", "day>=2026-02-02");
+    REQUIRE(query != nullptr);
+
+    // Calling the shared object functions. The blocks have 2 rows, so only the last two can match
+    REQUIRE(csvBuildZoneMap(path, 2, CSV_QUOTES_NONE) == 1);
+
+    char output[256];
+    CsvSink sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileToSink(query, path, &sink);
+    CsvQueryStats stats = csvQueryGetStats(query);
+
+    // Checking if the output and the statistics are correct
+    REQUIRE(std::string(output, sink.size) == "value\nd\ne\n");
+    REQUIRE(stats.blocksScanned == 2);
+    REQUIRE(stats.blocksSkipped == 1);
+
+    // With strict quoting every block is checked, so the invalid quoted field of the first block is found
+    std::ofstream(path) << "day,value\n2026-01-01,a\"\n2026-01-02,b\n2026-02-01,c\n2026-02-02,d\n2026-03-01,e\n";
+    REQUIRE(csvBuildZoneMap(path, 2, CSV_QUOTES_STRICT) == 1);
+    csvQuerySetQuoteMode(query, CSV_QUOTES_STRICT);
+    sink = csvBufferSink(output, sizeof(output));
+    CsvResult result = csvQueryRunFileChecked(query, path, &sink);
+    stats = csvQueryGetStats(query);
+
+    REQUIRE(result.status == CSV_ERROR_INVALID_CSV);
+    REQUIRE(stats.blocksSkipped == 0);
+
+    csvQueryFree(query);
+    std::remove(path);
+    std::remove((std::string(path) + ".zmap").c_str());
+}
+
+TEST_CASE("csvQueryRunFile should answer from a fresh columnar cache", "[test-28]" ) {
+    // Tests variables. The file is written by the test and removed at the end
+    const char path[] = "columnar-cache-test.csv";
+    std::ofstream(path) << "id,city,note\n1,Paris,\"a,b\"\n2,Rome,c\n3,Paris\n4,Oslo,\"d\n\"\"e\"\"\"\n";
+    CsvQuery* query = csvQueryPrepare("note,id", "city=Paris\ncity=Oslo\nid>1");
+    REQUIRE(query != nullptr);
+    csvQuerySetQuoteMode(query, CSV_QUOTES_PERMISSIVE);
+
+    // Calling the shared object functions, with and without dictionary encoding
+    std::string expected = "id,note\n3,\n4,\"d\n\"\"e\"\"\"\n";
+    char output[256];
+    for (int dictionaryEncode = 0; dictionaryEncode <= 1; ++dictionaryEncode) {
+        REQUIRE(csvBuildColumnarCache(path, CSV_QUOTES_PERMISSIVE, dictionaryEncode) == 1);
+
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+        csvQueryRunFileToSink(query, path, &sink);
+        REQUIRE(std::string(output, sink.size) == expected);
+
+        sink = csvBufferSink(output, sizeof(output));
+        csvQueryRunFileRowsToSink(query, path, 3, 1, &sink);
+        REQUIRE(std::string(output, sink.size) == "id,note\n4,\"d\n\"\"e\"\"\"\n");
+    }
+
+    // Once the file changes the cache is stale and it's ignored
+    std::ofstream(path) << "id,city,note\n1,Paris,x\n2,Paris,y\n";
+    CsvSink sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileToSink(query, path, &sink);
+    REQUIRE(std::string(output, sink.size) == "id,note\n2,y\n");
+
+    csvQueryFree(query);
+    std::remove(path);
+    std::remove((std::string(path) + ".col").c_str());
+}
+
+TEST_CASE("csvQueryRunFile should filter dictionary encoded columns by code", "[test-29]" ) {
+    // Tests variables. The file is written by the test and removed at the end. Only the id column has many distinct values
+    const char path[] = "dictionary-test.csv";
+    std::ofstream file(path);
+    file << "id,city,amount\n";
+    for (int i = 0; i < 3000; ++i) {
+        file << i << ',' << (i % 3 == 0 ? "Paris" : i % 3 == 1 ? "Rome" : "Oslo") << ',' << i % 7 << '\n';
+    }
+    file.close();
+    REQUIRE(csvBuildColumnarCache(path, CSV_QUOTES_NONE, 1) == 1);
+
+    // Calling the shared object functions
+    CsvQuery* query = csvQueryPrepare("id", "city!=Paris\ncity!=Rome\namount>4\nid<20");
+    REQUIRE(query != nullptr);
+    REQUIRE(csvQuerySetColumnType(query, "amount", CSV_TYPE_INTEGER) == 1);
+    REQUIRE(csvQuerySetColumnType(query, "id", CSV_TYPE_INTEGER) == 1);
+    char output[256];
+    CsvSink sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileToSink(query, path, &sink);
+
+    // Checking if the output is correct: every city satisfies one of the city filters, and no city is Lima
+    REQUIRE(std::string(output, sink.size) == "id\n5\n6\n12\n13\n19\n");
+    csvQueryFree(query);
+
+
+    query = csvQueryPrepare("id", "city=Lima");
+    REQUIRE(query != nullptr);
+    sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileToSink(query, path, &sink);
+    REQUIRE(std::string(output, sink.size) == "id\n");
+
+    csvQueryFree(query);
+    std::remove(path);
+    std::remove((std::string(path) + ".col").c_str());
+}
+
+TEST_CASE("csvQueryRun should aggregate the rows that satisfy the filters", "[test-30]" ) {
+    // Tests variables
+    const char csv[] = "city,amount,day\nRome,5,2026-01-02\nParis,2.5,2026-03-01\nRome,x,2025-12-31\nOslo,7,\nParis,4,2026-01-01\n";
+    char output[256];
+
+    SECTION("Grouped by the selected columns"){
+        CsvQuery* query = csvQueryPrepare("city", "city!=Oslo");
+        REQUIRE(query != nullptr);
+        REQUIRE(csvQuerySetAggregates(query, "COUNT(*),sum(amount),AVG(amount),MIN(day),MAX(day)") == 1);
+        REQUIRE(csvQuerySetColumnType(query, "day", CSV_TYPE_DATE) == 1);
+
+        // Calling the shared object function. The values that aren't numbers are left out of SUM and AVG
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+        csvQueryRunToSink(query, csv, &sink);
+        csvQueryFree(query);
+
+        // Checking if the output is correct. The groups are in the order of their first row
+        REQUIRE(std::string(output, sink.size) == "city,COUNT(*),sum(amount),AVG(amount),MIN(day),MAX(day)\n"
+                                                  "Rome,2,5,5,2025-12-31,2026-01-02\nParis,2,6.5,3.25,2026-01-01,2026-03-01\n");
+    }
+
+    SECTION("Without grouping columns"){
+        CsvQuery* query = csvQueryPrepare("", "city=Lima");
+        REQUIRE(query != nullptr);
+        REQUIRE(csvQuerySetAggregates(query, "COUNT(day),SUM(amount)") == 1);
+
+        // Calling the shared object function. There's always one group, even without rows
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+        csvQueryRunToSink(query, csv, &sink);
+        csvQueryFree(query);
+
+        // Checking if the output is correct
+        REQUIRE(std::string(output, sink.size) == "COUNT(day),SUM(amount)\n0,\n");
+    }
+
+    SECTION("Invalid aggregates"){
+        CsvQuery* query = csvQueryPrepare("city", "city!=Oslo");
+        REQUIRE(query != nullptr);
+
+        // Storing the cerr buffer
+        std::stringstream buffer;
+        std::streambuf* oldCerr = std::cerr.rdbuf(buffer.rdbuf());
+
+        // Calling the shared object functions
+        REQUIRE(csvQuerySetAggregates(query, "SUM(*)") == 0);
+        REQUIRE(csvQuerySetAggregates(query, "MEDIAN(amount)") == 0);
+        REQUIRE(csvQuerySetAggregates(query, "MAX(price)") == 1);
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+        csvQueryRunToSink(query, csv, &sink);
+
+        // Restoring the cerr buffer
+        std::cerr.rdbuf(oldCerr);
+        csvQueryFree(query);
+
+        // Checking if the errors are correct
+        REQUIRE(buffer.str() == "Invalid aggregate: 'SUM(*)'\nInvalid aggregate: 'MEDIAN(amount)'\nHeader 'price' not found in CSV file/string\n");
+    }
+
+    SECTION("Without a prepared query"){
+        const char path[] = "aggregate-test.csv";
+        std::ofstream(path) << csv;
+
+        // Storing the cout and cerr buffers
+        std::stringstream buffer;
+        std::stringstream errStream;
+        std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+        std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+        // Calling the shared object functions
+        processCsvAggregate(csv, "city", "COUNT(*),SUM(amount)", "day>2026");
+        processCsvFileAggregate(path, "", "COUNT(city)", "city!=Oslo");
+        processCsvAggregate(csv, "city", "SUM(*)", "day>2026");
+
+        // Restoring the cout and cerr buffers
+        std::cout.rdbuf(oldCout);
+        std::cerr.rdbuf(oldCerr);
+        std::remove(path);
+
+        // Checking if the output is correct
+        REQUIRE(buffer.str() == "city,COUNT(*),SUM(amount)\nRome,1,5\nParis,2,6.5\n" "COUNT(city)\n4\n");
+        REQUIRE(errStream.str() == "Invalid aggregate: 'SUM(*)'\n");
+    }
+}
+
+TEST_CASE("csvQueryCount and csvQueryExists should only report the matching rows", "[test-31]" ) {
+    // Tests variables. The last row has a malformed quoted field, which is only found if it's read
+    const char csv[] = "id,city,note\n1,Rome,a\n2,Paris,b\n3,Rome,c\n4,Oslo,x\"y\n";
+    const char path[] = "count-test.csv";
+    std::ofstream(path) << csv;
+    CsvQuery* query = csvQueryPrepare("note", "city=Rome\ncity=Lima");
+    REQUIRE(query != nullptr);
+
+    // Calling the shared object functions
+    size_t count = 0;
+    REQUIRE(csvQueryCount(query, csv, &count) == 1);
+    REQUIRE(count == 2);
+    count = 0;
+    REQUIRE(csvQueryCountFile(query, path, &count) == 1);
+    REQUIRE(count == 2);
+    REQUIRE(csvQueryExists(query, csv) == 1);
+    REQUIRE(csvQueryExistsFile(query, path) == 1);
+
+    // The exists mode stops at the first match, so the malformed field is never validated
+    std::stringstream buffer;
+    std::streambuf* oldCerr = std::cerr.rdbuf(buffer.rdbuf());
+    csvQuerySetQuoteMode(query, CSV_QUOTES_STRICT);
+    REQUIRE(csvQueryExists(query, csv) == 1);
+    REQUIRE(csvQueryCount(query, csv, &count) == 0);
+    std::cerr.rdbuf(oldCerr);
+    REQUIRE(buffer.str() == "Invalid quoted field: the CSV ends inside a quoted field\n");
+    csvQueryFree(query);
+
+    query = csvQueryPrepare("", "city=Lima");
+    REQUIRE(query != nullptr);
+    REQUIRE(csvQueryCount(query, csv, &count) == 1);
+    REQUIRE(count == 0);
+    REQUIRE(csvQueryExistsFile(query, path) == 0);
+
+    csvQueryFree(query);
+    std::remove(path);
+}
+
+TEST_CASE("csvQuerySetLimit should skip and limit the rows that satisfy the filters", "[test-32]" ) {
+    // Tests variables. The last row has a malformed quoted field, which is only found if it's read
+    const char csv[] = "id,city\n1,Rome\n2,Paris\n3,Rome\n4,Rome\n5,Oslo\n6,Rome\n7,\"Ro\"me\n";
+    const char path[] = "limit-test.csv";
+    std::ofstream(path) << csv;
+    CsvQuery* query = csvQueryPrepare("id", "city=Rome");
+    REQUIRE(query != nullptr);
+
+    // Calling the shared object functions
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+    csvQuerySetLimit(query, 1, 2);
+    csvQueryRun(query, csv);
+    csvQueryRunFile(query, path);
+    csvQuerySetLimit(query, 3, SIZE_MAX);
+    csvQueryRun(query, csv);
+    csvQuerySetLimit(query, 0, 0);
+    csvQueryRunFile(query, path);
+    std::cout.rdbuf(oldCout);
+    REQUIRE(buffer.str() == "id\n3\n4\n" "id\n3\n4\n" "id\n6\n" "id\n");
+
+    // The count mode ignores the limit, and the run stops before the malformed field
+    size_t count = 0;
+    REQUIRE(csvQueryCount(query, csv, &count) == 1);
+    REQUIRE(count == 4);
+    buffer.str("");
+    oldCout = std::cout.rdbuf(buffer.rdbuf());
+    csvQuerySetQuoteMode(query, CSV_QUOTES_STRICT);
+    csvQuerySetLimit(query, 0, 3);
+    csvQueryRun(query, csv);
+    csvQueryRunFile(query, path);
+    std::cout.rdbuf(oldCout);
+    REQUIRE(buffer.str() == "id\n1\n3\n4\n" "id\n1\n3\n4\n");
+    csvQueryFree(query);
+
+    // In aggregation mode the limit applies to the groups
+    query = csvQueryPrepare("city", "id!=0");
+    REQUIRE(query != nullptr);
+    REQUIRE(csvQuerySetAggregates(query, "COUNT(*)") == 1);
+    csvQuerySetLimit(query, 1, 1);
+    buffer.str("");
+    oldCout = std::cout.rdbuf(buffer.rdbuf());
+    csvQueryRun(query, csv);
+    std::cout.rdbuf(oldCout);
+    REQUIRE(buffer.str() == "city,COUNT(*)\nParis,1\n");
+    csvQueryFree(query);
+
+    // A big input is split in slices between the threads. The rows of the limit are spread over many slices,
+    // and the slices after them stop as soon as the ones before them are known to have enough rows
+    std::string bigCsv = "id,city\n";
+    for (int i = 0; i < 400000; ++i) {
+        bigCsv += std::to_string(i) + (i % 20000 == 7 ? ",Rome\n" : ",Paris\n");
+    }
+    query = csvQueryPrepare("id", "city=Rome");
+    REQUIRE(query != nullptr);
+    setCsvThreadCount(4);
+    buffer.str("");
+    oldCout = std::cout.rdbuf(buffer.rdbuf());
+    csvQuerySetLimit(query, 2, 3);
+    csvQueryRun(query, bigCsv.c_str());
+    csvQuerySetLimit(query, 0, 1);
+    csvQueryRun(query, bigCsv.c_str());
+    std::cout.rdbuf(oldCout);
+    setCsvThreadCount(0);
+    REQUIRE(buffer.str() == "id\n40007\n60007\n80007\n" "id\n7\n");
+
+    csvQueryFree(query);
+    std::remove(path);
+}
+
+TEST_CASE("processCsvFileStream should pipeline big inputs and outputs", "[test-33]" ) {
+    // Tests variables. The output is bigger than a block of the output buffer, so it goes through the writer thread
+    const char path[] = "pipeline-test.csv";
+    std::string csv = "id,group,note\n";
+    std::string expected = "id,note\n";
+    for (int i = 0; i < 100000; ++i) {
+        std::string row = std::to_string(i) + "," + std::to_string(i % 3) + ",note" + std::string(i % 17, 'x');
+        csv += row + "\n";
+        if (i % 3 != 1) expected += std::to_string(i) + ",note" + std::string(i % 17, 'x') + "\n";
+    }
+    std::ofstream(path) << csv;
+
+    // Calling the shared object functions, with chunks of 64 KB so the reader thread reads many of them
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+    processCsvFileStream(path, "id,note", "group!=1", 64 << 10);
+    std::cout.rdbuf(oldCout);
+    REQUIRE(buffer.str() == expected);
+
+    std::string output(csv.size(), '\0');
+    CsvSink sink = csvBufferSink(&output[0], output.size());
+    processCsvToSink(csv.c_str(), "id,note", "group!=1", &sink);
+    REQUIRE(std::string(output.data(), sink.size) == expected);
+
+    std::remove(path);
+}
+
+TEST_CASE("processCsv should keep the rows in order when the rows get wider", "[test-34]" ) {
+    // Tests variables. The rows at the end are 10 times wider, so the threads steal each other's slices
+    std::string csv = "id,note,group\n";
+    for (int i = 0; i < 150000; ++i) {
+        csv += std::to_string(i) + "," + std::string(i < 100000 ? 20 : 200, 'n') + "," + std::to_string(i % 10) + "\n";
+    }
+    const char selectedColumns[] = "id,group";
+    const char rowFilterDefinitions[] = "group=3\ngroup=7";
+
+    // The output of a single thread is the reference
+    setCsvThreadCount(1);
+    std::stringstream expected;
+    std::streambuf* oldCout = std::cout.rdbuf(expected.rdbuf());
+    processCsv(csv.c_str(), selectedColumns, rowFilterDefinitions);
+    std::cout.rdbuf(oldCout);
+
+    // Calling the shared object function
+    std::stringstream buffer;
+    oldCout = std::cout.rdbuf(buffer.rdbuf());
+    setCsvThreadCount(3);
+    processCsv(csv.c_str(), selectedColumns, rowFilterDefinitions);
+    setCsvThreadCount(0);
+    std::cout.rdbuf(oldCout);
+
+    // Checking if the output is correct
+    REQUIRE(expected.str().size() > 100000);
+    REQUIRE(buffer.str() == expected.str());
+}
+
+TEST_CASE("csvQueryRun should keep a prepared query valid while it's bound to many headers", "[test-35]" ) {
+    // Tests variables. The name with escaped quotes is unquoted into a copy, and the headers change on every run,
+    // so the plan of the query is built again (in a released arena) every time
+    const char csv1[] = "id,\"na\"\"me\",amount\n1,x,4\n2,y,9\n";
+    const char csv2[] = "amount,\"na\"\"me\",id,note\n7,z,3,a\n1,w,4,b\n";
+    CsvQuery* query = csvQueryPrepare("na\"me,id", "amount>5");
+    REQUIRE(query != nullptr);
+    csvQuerySetQuoteMode(query, CSV_QUOTES_PERMISSIVE);
+    REQUIRE(csvQuerySetColumnType(query, "amount", CSV_TYPE_INTEGER) == 1);
+
+    // Storing the cout buffer
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+    // Calling the shared object function
+    std::string expected;
+    for (int i = 0; i < 50; ++i) {
+        csvQueryRun(query, i % 2 == 0 ? csv1 : csv2);
+        expected += i % 2 == 0 ? "id,\"na\"\"me\"\n2,y\n" : "\"na\"\"me\",id\nz,3\n";
+    }
+
+    // Restoring the cout buffer
+    std::cout.rdbuf(oldCout);
+    csvQueryFree(query);
+
+    // Checking if the output is correct
+    REQUIRE(buffer.str() == expected);
+}
+
+TEST_CASE("The checked functions should return the errors and run on many threads at once", "[test-36]" ) {
+    // Tests variables
+    const char csv[] = "header1,header2,header3\n1,2,3\n4,5,6\n7,8,9";
+
+    SECTION("Errors"){
+        // Storing the cerr buffer
+        std::stringstream errStream;
+        std::streambuf* oldCerr = std::cerr.rdbuf(errStream.rdbuf());
+
+        // Calling the shared object functions
+        char output[64];
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+        CsvResult invalidFilter = processCsvChecked(csv, "header1", "header1>>>1", &sink);
+        CsvResult missingFile = processCsvFileChecked("missing-file.csv", "header1", "header1>1", &sink);
+        CsvResult missingHeader = processCsvChecked(csv, "header4", "header1>1", &sink);
+        CsvQuery* query = nullptr;
+        CsvResult invalidQuery = csvQueryPrepareChecked("header1", "", &query);
+        CsvResult noQuery = csvQueryRunChecked(query, csv, &sink);
+
+        // Restoring the cerr buffer
+        std::cerr.rdbuf(oldCerr);
+
+        // Checking if the errors are returned and nothing is printed
+        REQUIRE(invalidFilter.status == CSV_ERROR_INVALID_QUERY);
+        REQUIRE(std::string(invalidFilter.message) == "Invalid filter: 'header1>>>1'");
+        REQUIRE(missingFile.status == CSV_ERROR_OPENING_FILE);
+        REQUIRE(std::string(missingFile.message) == "Error opening CSV file");
+        REQUIRE(missingHeader.status == CSV_ERROR_INVALID_CSV);
+        REQUIRE(std::string(missingHeader.message) == "Header 'header4' not found in CSV file/string");
+        REQUIRE(invalidQuery.status == CSV_ERROR_INVALID_QUERY);
+        REQUIRE(query == nullptr);
+        REQUIRE(noQuery.status == CSV_ERROR_INVALID_QUERY);
+        REQUIRE(sink.size == 0);
+        REQUIRE(errStream.str().empty());
+    }
+
+    SECTION("Output that can't be written"){
+        // A file descriptor opened only for reading fails every write
+        int fd = open("/dev/null", O_RDONLY);
+        REQUIRE(fd >= 0);
+        CsvSink sink = csvFdSink(fd);
+
+        // Calling the shared object function
+        CsvResult result = processCsvChecked(csv, "header1", "header1>1", &sink);
+        close(fd);
+
+        // Checking if the error is returned
+        REQUIRE(result.status == CSV_ERROR_WRITING_OUTPUT);
+        REQUIRE(sink.error == EBADF);
+        REQUIRE(std::string(result.message).find("Error writing the output") == 0);
+
+        // The error of a previous call isn't reported again
+        char output[64];
+        CsvSink bufferSink = csvBufferSink(output, sizeof(output));
+        bufferSink.error = EBADF;
+        REQUIRE(processCsvChecked(csv, "header1", "header1>1", &bufferSink).status == CSV_OK);
+    }
+
+    SECTION("Input that can't be read"){
+        // A directory can be opened, but every read of it fails (EISDIR), which isn't the end of the input
+        char output[64];
+        CsvSink sink = csvBufferSink(output, sizeof(output));
+        CsvResult result = processCsvFileChecked(".", "header1", "header1>1", &sink);
+
+        // Checking if the error is returned
+        REQUIRE(result.status == CSV_ERROR_READING_INPUT);
+        REQUIRE(std::string(result.message).find("Error reading the CSV file") == 0);
+        REQUIRE(sink.size == 0);
+    }
+
+    SECTION("Many threads"){
+        // Each thread runs its own query and a one-shot call many times, with its own sinks
+        const int threadCount = 8;
+        std::vector<std::string> outputs(threadCount);
+        std::vector<int> failures(threadCount, 0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t]() {
+                CsvQuery* query = nullptr;
+                if (csvQueryPrepareChecked("header1,header3", "header1>1\nheader3<8", &query).status != CSV_OK) {
+                    ++failures[t];
+                    return;
+                }
+                for (int i = 0; i < 200; ++i) {
+                    char output[64];
+                    CsvSink sink = csvBufferSink(output, sizeof(output));
+                    if (processCsvChecked(csv, "header2", "header3>5", &sink).status != CSV_OK) ++failures[t];
+                    if (csvQueryRunChecked(query, csv, &sink).status != CSV_OK) ++failures[t];
+                    outputs[t] = std::string(output, sink.size);
+                }
+                csvQueryFree(query);
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        // Checking if the output of every thread is correct
+        for (int t = 0; t < threadCount; ++t) {
+            REQUIRE(failures[t] == 0);
+            REQUIRE(outputs[t] == "header2\n5\n8\nheader1,header3\n4,6\n");
+        }
+    }
+}
+
+TEST_CASE("csvQueryRunFile should scan the CSV when the columnar cache is corrupt", "[test-37]" ) {
+    // Tests variables. The file is written by the test and removed at the end
+    const char path[] = "corrupt-cache-test.csv";
+    const std::string cachePath = std::string(path) + ".col";
+    std::ofstream file(path);
+    file << "id,city,amount\n";
+    for (int i = 0; i < 3000; ++i) {
+        file << i << ',' << (i % 3 == 0 ? "Paris" : i % 3 == 1 ? "Rome" : "Oslo") << ',' << i % 7 << '\n';
+    }
+    file.close();
+    REQUIRE(csvBuildColumnarCache(path, CSV_QUOTES_NONE, 1) == 1);
+
+    // Overwrites 1000 bytes of the cache at position with 0xFF, keeping its size so it still looks fresh
+    auto corruptCache = [&](std::streamoff position) {
+        std::fstream cache(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+        cache.seekp(position);
+        cache << std::string(1000, '\xFF');
+    };
+    size_t firstRow = 0;
+    std::string expected;
+
+    SECTION("Values outside the heap"){
+        // The offsets of the id values come right after the header of the cache, 8 bytes per row
+        corruptCache(1000);
+        firstRow = 100;
+        expected = "id,amount\n100,2\n101,3\n102,4\n";
+    }
+
+    SECTION("Codes outside the dictionary"){
+        // The codes of the amount column come right before its small dictionary, at the end of the cache, 4 bytes per row
+        std::ifstream cache(cachePath, std::ios::binary | std::ios::ate);
+        corruptCache(static_cast<std::streamoff>(cache.tellg()) - 4000);
+        firstRow = 2100;
+        expected = "id,amount\n2100,0\n2101,1\n2102,2\n";
+    }
+
+    // Calling the shared object functions on rows whose cached values were overwritten
+    CsvQuery* query = csvQueryPrepare("id,amount", "amount<7");
+    REQUIRE(query != nullptr);
+    REQUIRE(csvQuerySetColumnType(query, "amount", CSV_TYPE_INTEGER) == 1);
+    char output[256];
+    CsvSink sink = csvBufferSink(output, sizeof(output));
+    csvQueryRunFileRowsToSink(query, path, firstRow, 3, &sink);
+    csvQueryFree(query);
+
+    // Checking if the output is correct
+    REQUIRE(std::string(output, sink.size) == expected);
+
+    std::remove(path);
+    std::remove(cachePath.c_str());
+}
+
+TEST_CASE("processCsv should OR the filters of a column and AND the columns", "[test-38]" ) {
+    // Storing the cout buffer
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+
+    // Tests variables. The filters of each column are mixed, so they are grouped by column before checking the rows.
+    // The rows 4,9 and 5,0 fail the group of a, the first one, and the row 3,4 only fails the group of b
+    const char csv[] = "a,b\n1,7\n2,1\n3,4\n4,9\n5,0\n2,8";
+    const char selectedColumns[] = "a,b";
+    const char rowFilterDefinitions[] = "b>5\na=1\nb<2\na=3\na=2";
+
+    // Calling the shared object function
+    processCsv(csv, selectedColumns, rowFilterDefinitions);
+
+    // Restoring the cout buffer
+    std::cout.rdbuf(oldCout);
+
+    // Checking if the output is correct
+    REQUIRE(buffer.str() == "a,b\n1,7\n2,1\n2,8\n");
+}
@@ -19,3 +19,509 @@ void processCsv(const char[], const char[], const char[]);
  * @return void
  */
 void processCsvFile(const char[], const char[], const char[]);
+
+/**
+ * Process the CSV file reading it in chunks instead of loading (or mapping) it entirely.
+ * Rows crossing the end of a chunk are carried over to the next one and the output is flushed
+ * incrementally, so the memory used is bounded no matter how big the file is.
+ *
+ * @param csvFilePath The file path of the CSV to be processed.
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ * @param chunkSize The size in bytes of each read (0 for the default of 4 MB). It grows only if a single row doesn't fit in it.
+ *
+ * @return void
+ */
+void processCsvFileStream(const char[], const char[], const char[], size_t);
+
+/**
+ * Aggregate the rows of the CSV data that satisfy the filters, grouped by the selected columns.
+ * It's processCsv with the aggregates of csvQuerySetAggregates, which describes the output.
+ *
+ * @param csv The CSV data to be processed.
+ * @param selectedColumns The columns the rows are grouped by. Empty for a single group.
+ * @param aggregates The aggregates separated by commas, e.g. "COUNT(*),SUM(amount)".
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ *
+ * @return void
+ */
+void processCsvAggregate(const char[], const char[], const char[], const char[]);
+
+/**
+ * Aggregate the rows of the CSV file that satisfy the filters, grouped by the selected columns.
+ * It's processCsvFile with the aggregates of csvQuerySetAggregates, which describes the output.
+ *
+ * @param csvFilePath The file path of the CSV to be processed.
+ * @param selectedColumns The columns the rows are grouped by. Empty for a single group.
+ * @param aggregates The aggregates separated by commas, e.g. "COUNT(*),SUM(amount)".
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ *
+ * @return void
+ */
+void processCsvFileAggregate(const char[], const char[], const char[], const char[]);
+
+/**
+ * Where the output is written:
+ * CSV_SINK_STDOUT   - std::cout, as processCsv does.
+ * CSV_SINK_BUFFER   - a buffer of the caller. It's not null terminated.
+ * CSV_SINK_FD       - a file descriptor.
+ * CSV_SINK_CALLBACK - a function of the caller, called with blocks of the output.
+ */
+typedef enum CsvSinkType
+{
+    CSV_SINK_STDOUT,
+    CSV_SINK_BUFFER,
+    CSV_SINK_FD,
+    CSV_SINK_CALLBACK
+} CsvSinkType;
+
+typedef void (*CsvWriteCallback)(void* context, const char* data, size_t size);
+
+/**
+ * Output of a query, created by csvStdoutSink, csvBufferSink, csvFdSink or csvCallbackSink.
+ * The output is written in blocks of up to 1 MB, not row by row. When there's more than one block, they are written
+ * by a thread of the library while the rows are processed, one at a time and in order, and always before the call returns.
+ *
+ * buffer, capacity - CSV_SINK_BUFFER: where the output is copied.
+ * size             - CSV_SINK_BUFFER: bytes of output. If it's bigger than the capacity, the output was truncated.
+ * fd               - CSV_SINK_FD: the file descriptor.
+ * callback, context - CSV_SINK_CALLBACK: the function and its first argument.
+ * error            - CSV_SINK_FD and CSV_SINK_STDOUT: the errno of the first write that failed, 0 if none did.
+ *                    Once a write fails, the rest of the output is dropped. The checked functions set it to 0 when
+ *                    they start and report it as CSV_ERROR_WRITING_OUTPUT.
+ */
+typedef struct CsvSink
+{
+    CsvSinkType type;
+    char* buffer;
+    size_t capacity;
+    size_t size;
+    int fd;
+    CsvWriteCallback callback;
+    void* context;
+    int error;
+} CsvSink;
+
+CsvSink csvStdoutSink(void);
+CsvSink csvBufferSink(char* buffer, size_t capacity);
+CsvSink csvFdSink(int fd);
+CsvSink csvCallbackSink(CsvWriteCallback callback, void* context);
+
+/**
+ * Process the CSV data the same way as processCsv, writing the output in the sink.
+ *
+ * @param csv The CSV data to be processed.
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ * @param sink Where the output is written.
+ *
+ * @return void
+ */
+void processCsvToSink(const char[], const char[], const char[], CsvSink*);
+
+/**
+ * Process the CSV file the same way as processCsvFile, writing the output in the sink.
+ *
+ * @param csvFilePath The file path of the CSV to be processed.
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ * @param sink Where the output is written.
+ *
+ * @return void
+ */
+void processCsvFileToSink(const char[], const char[], const char[], CsvSink*);
+
+/**
+ * Outcome of a checked function:
+ * CSV_OK                   - the output was written in the sink.
+ * CSV_ERROR_INVALID_QUERY  - the selected columns, the filters or the query itself are invalid.
+ * CSV_ERROR_OPENING_FILE   - the CSV file can't be opened.
+ * CSV_ERROR_INVALID_CSV    - the CSV doesn't fit the query (e.g. a column that isn't in the header, or a filter value
+ *                            that isn't of the type of its column) or it's invalid in the quote mode of the query.
+ *                            Part of the output may have been written already.
+ * CSV_ERROR_WRITING_OUTPUT - the output couldn't be written in the sink (see the error of CsvSink), so part of it was lost.
+ * CSV_ERROR_READING_INPUT  - a read of the CSV file failed before its end. Part of the output may have been written already.
+ * CSV_ERROR_INTERNAL       - the library failed for a reason unrelated to the input (e.g. out of memory).
+ */
+typedef enum CsvStatus
+{
+    CSV_OK,
+    CSV_ERROR_INVALID_QUERY,
+    CSV_ERROR_OPENING_FILE,
+    CSV_ERROR_INVALID_CSV,
+    CSV_ERROR_WRITING_OUTPUT,
+    CSV_ERROR_READING_INPUT,
+    CSV_ERROR_INTERNAL
+} CsvStatus;
+
+#define CSV_RESULT_MESSAGE_SIZE 256
+
+/**
+ * Result of a checked function, returned by value.
+ * status  - CSV_OK or the kind of error.
+ * message - the error, as the unchecked functions print it (truncated to fit), null terminated. Empty with CSV_OK.
+ */
+typedef struct CsvResult
+{
+    CsvStatus status;
+    char message[CSV_RESULT_MESSAGE_SIZE];
+} CsvResult;
+
+/**
+ * Process the CSV data the same way as processCsvToSink, returning the error instead of printing it.
+ * The checked functions never use std::cout nor std::cerr (unless the sink is csvStdoutSink) and have no shared
+ * state between calls, so many threads can call them at the same time, each one with its own sink.
+ *
+ * @param csv The CSV data to be processed.
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ * @param sink Where the output is written.
+ *
+ * @return The result of the call.
+ */
+CsvResult processCsvChecked(const char[], const char[], const char[], CsvSink*);
+
+/**
+ * Process the CSV file the same way as processCsvFileToSink, returning the error instead of printing it.
+ * It can be called by many threads at the same time, as processCsvChecked.
+ *
+ * @param csvFilePath The file path of the CSV to be processed.
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ * @param sink Where the output is written.
+ *
+ * @return The result of the call.
+ */
+CsvResult processCsvFileChecked(const char[], const char[], const char[], CsvSink*);
+
+/**
+ * Query prepared by csvQueryPrepare.
+ */
+typedef struct CsvQuery CsvQuery;
+
+/**
+ * Prepare a query that can be run on many CSV inputs. The selectedColumns and the rowFilterDefinitions are
+ * parsed only once, and the plan built for a header is reused by the next inputs with the same header.
+ * A query must not be run by more than one thread at the same time.
+ *
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ *
+ * @return The query, to be released with csvQueryFree. NULL if there's an invalid filter (the error is printed).
+ *         An unknown comparator made of comparator characters (e.g. "=>") is reported when the query is run on rows.
+ */
+CsvQuery* csvQueryPrepare(const char[], const char[]);
+
+/**
+ * Process the CSV data with a prepared query, the same way as processCsv.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param csv The CSV data to be processed.
+ *
+ * @return void
+ */
+void csvQueryRun(CsvQuery*, const char[]);
+
+/**
+ * Process the CSV file with a prepared query, the same way as processCsvFile.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param csvFilePath The file path of the CSV to be processed.
+ *
+ * @return void
+ */
+void csvQueryRunFile(CsvQuery*, const char[]);
+
+/**
+ * Same as csvQueryRun and csvQueryRunFile, writing the output in the sink.
+ */
+void csvQueryRunToSink(CsvQuery*, const char[], CsvSink*);
+void csvQueryRunFileToSink(CsvQuery*, const char[], CsvSink*);
+
+/**
+ * Same as csvQueryRunFileToSink, processing only some rows of the file.
+ * If the file has a fresh row index (see csvBuildRowIndex), the first row is found without reading the rows before it.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param csvFilePath The path of the CSV file.
+ * @param firstRow The first row processed, counting from 0 (the first row after the header).
+ * @param rowCount The number of rows processed. SIZE_MAX processes every row after firstRow.
+ * @param sink Where the output is written.
+ *
+ * @return void
+ */
+void csvQueryRunFileRowsToSink(CsvQuery*, const char[], size_t, size_t, CsvSink*);
+
+/**
+ * Count the rows of the CSV string that satisfy the filters of the query, without writing anything.
+ * Only the fields up to the last filtered column are split, so it's faster than running the query.
+ *
+ * @param query The query returned by csvQueryPrepare. Its selected columns and aggregates are ignored.
+ * @param csv The CSV data, with the header columns in the first line.
+ * @param count Where the number of rows is stored.
+ *
+ * @return 1 if the rows were counted, 0 otherwise (the error is printed).
+ */
+int csvQueryCount(CsvQuery*, const char[], size_t*);
+
+/**
+ * Same as csvQueryCount, but reading the CSV from a file (see csvQueryRunFile).
+ */
+int csvQueryCountFile(CsvQuery*, const char[], size_t*);
+
+/**
+ * Check if any row of the CSV string satisfies the filters of the query, without writing anything.
+ * The processing stops at the first row that satisfies them.
+ *
+ * @param query The query returned by csvQueryPrepare. Its selected columns and aggregates are ignored.
+ * @param csv The CSV data, with the header columns in the first line.
+ *
+ * @return 1 if a row satisfies the filters, 0 if none does, and -1 if there's an error (the error is printed).
+ */
+int csvQueryExists(CsvQuery*, const char[]);
+
+/**
+ * Same as csvQueryExists, but reading the CSV from a file (see csvQueryRunFile). The rest of the file
+ * isn't read once a row satisfies the filters.
+ */
+int csvQueryExistsFile(CsvQuery*, const char[]);
+
+/**
+ * How the quotes of the CSV are handled:
+ * CSV_QUOTES_NONE       - quotes are ordinary characters (the default).
+ * CSV_QUOTES_PERMISSIVE - RFC 4180 quoted fields, which can have commas, newlines and escaped quotes ("").
+ *                         Malformed quotes are accepted.
+ * CSV_QUOTES_STRICT     - RFC 4180 quoted fields. A malformed quoted field in the header or in a column
+ *                         used by the query stops the processing with an error.
+ * The filters and the selectedColumns compare the values without their quotes, and the output keeps them.
+ */
+typedef enum CsvQuoteMode
+{
+    CSV_QUOTES_NONE,
+    CSV_QUOTES_PERMISSIVE,
+    CSV_QUOTES_STRICT
+} CsvQuoteMode;
+
+/**
+ * Set how the query handles quotes in the next runs.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param quoteMode CSV_QUOTES_NONE, CSV_QUOTES_PERMISSIVE or CSV_QUOTES_STRICT.
+ *
+ * @return void
+ */
+void csvQuerySetQuoteMode(CsvQuery*, CsvQuoteMode);
+
+/**
+ * Types used to compare the values of a column with the filters:
+ * CSV_TYPE_TEXT    - lexicographical comparison, as std::strcmp (the default).
+ * CSV_TYPE_INTEGER - 64 bits signed integers, so 9 < 10.
+ * CSV_TYPE_FLOAT   - floating point numbers, e.g. 1.5 or 2e-3, but not inf or nan.
+ * CSV_TYPE_DATE    - ISO 8601 dates and timestamps, e.g. 2026-01-31 or 2026-01-31T10:20:30Z.
+ * A field that isn't of the type of its column (e.g. an empty field) doesn't satisfy any filter of the column.
+ */
+typedef enum CsvColumnType
+{
+    CSV_TYPE_TEXT,
+    CSV_TYPE_INTEGER,
+    CSV_TYPE_FLOAT,
+    CSV_TYPE_DATE
+} CsvColumnType;
+
+/**
+ * Set the type of a column in the next runs of the query. The values of the filters of the column must be of the type,
+ * otherwise the run fails with an error.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param column The name of the column.
+ * @param columnType The type of the column.
+ *
+ * @return 1 if the type was set, 0 if columnType isn't valid.
+ */
+int csvQuerySetColumnType(CsvQuery*, const char[], CsvColumnType);
+
+/**
+ * Enable or disable the type inference of the filtered columns without a type set by csvQuerySetColumnType.
+ * The type is inferred from the first rows of the CSV (up to 1000 rows or 64 KB) when the query is bound to its header:
+ * integer, float or date if every non-empty value of the sample has the type, and the values of the filters too.
+ * Otherwise the column is compared as text.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param inferTypes Non-zero to infer the types.
+ *
+ * @return void
+ */
+void csvQueryInferTypes(CsvQuery*, int);
+
+/**
+ * Switch a query to aggregation mode: instead of the rows that satisfy the filters, the output has one row per group
+ * of rows with the same values in the selected columns (GROUP BY), with the selected columns followed by the aggregates.
+ * With no selected columns (selectedColumns was empty) every row is in the same group, and there's always one output row.
+ * The groups are written in the order of their first row, and their fields as they are in that row.
+ * The header has the selected columns followed by the aggregates as written.
+ * COUNT(*) counts the rows and COUNT(column) the non-empty values. SUM and AVG only use the values that are numbers,
+ * and SUM is an integer while every value is one. MIN and MAX compare the non-empty values with the type of the column
+ * (see csvQuerySetColumnType), ignoring the values of another type, and write the value as it is in the CSV.
+ * An aggregate without values (besides COUNT) is written as an empty field.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param aggregates The aggregates separated by commas, e.g. "COUNT(*),SUM(amount),MAX(day)". The functions are COUNT,
+ *                   SUM, MIN, MAX and AVG (in any case), and only COUNT accepts *. An empty string disables the mode.
+ *
+ * @return 1 if the aggregates are valid, 0 otherwise (the error is printed and the query is unchanged).
+ */
+int csvQuerySetAggregates(CsvQuery*, const char[]);
+
+/**
+ * Set how many of the rows that satisfy the filters a query writes, like LIMIT and OFFSET: the first offset rows
+ * are skipped, and only the next limit rows are written. The run ends as soon as the last of them is written,
+ * so the rest of the input is never read (nor its pages touched, for files). In aggregation mode they apply
+ * to the groups written instead, and the count and exists modes ignore them.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ * @param offset Rows skipped (0 to skip none).
+ * @param limit Rows written at most (SIZE_MAX for no limit).
+ */
+void csvQuerySetLimit(CsvQuery*, size_t, size_t);
+
+/**
+ * Release a query returned by csvQueryPrepare.
+ *
+ * @param query The query to be released. It can be NULL.
+ *
+ * @return void
+ */
+void csvQueryFree(CsvQuery*);
+
+/**
+ * Prepare a query the same way as csvQueryPrepare, returning the error instead of printing it.
+ *
+ * @param selectedColumns The columns to be selected from the CSV data.
+ * @param rowFilterDefinitions The filters to be applied to the CSV data.
+ * @param query Where the query is stored, to be released with csvQueryFree. It's set to NULL if there's an error.
+ *
+ * @return The result of the call.
+ */
+CsvResult csvQueryPrepareChecked(const char[], const char[], CsvQuery**);
+
+/**
+ * Process the CSV data with a prepared query the same way as csvQueryRunToSink, returning the error instead of printing it.
+ * Different queries can be run by different threads at the same time, but a query must not be run by more than one
+ * thread at the same time (each thread can prepare its own).
+ *
+ * @param query The query returned by csvQueryPrepare or csvQueryPrepareChecked.
+ * @param csv The CSV data to be processed.
+ * @param sink Where the output is written.
+ *
+ * @return The result of the call.
+ */
+CsvResult csvQueryRunChecked(CsvQuery*, const char[], CsvSink*);
+
+/**
+ * Process the CSV file with a prepared query the same way as csvQueryRunFileToSink, returning the error instead of
+ * printing it. The same as csvQueryRunChecked applies to the threads.
+ *
+ * @param query The query returned by csvQueryPrepare or csvQueryPrepareChecked.
+ * @param csvFilePath The file path of the CSV to be processed.
+ * @param sink Where the output is written.
+ *
+ * @return The result of the call.
+ */
+CsvResult csvQueryRunFileChecked(CsvQuery*, const char[], CsvSink*);
+
+/**
+ * Statistics of the last run of a query:
+ * blocksScanned, blocksSkipped - blocks of the zone map (see csvBuildZoneMap) that were processed and that were
+ *                                skipped because none of their rows could satisfy the filters. Both are 0 without zone map.
+ * arenaAllocations, arenaHeapBlocks - allocations made so far in the arenas of the query (its parsed state and its plan)
+ *                                     and blocks of memory the arenas took from the heap. They are only counted when the
+ *                                     library is built with CSV_DEBUG_STATS=1 ./build_libcsv.sh, and are 0 otherwise.
+ */
+typedef struct CsvQueryStats
+{
+    size_t blocksScanned;
+    size_t blocksSkipped;
+    size_t arenaAllocations;
+    size_t arenaHeapBlocks;
+} CsvQueryStats;
+
+/**
+ * Get the statistics of the last run of a query.
+ *
+ * @param query The query returned by csvQueryPrepare.
+ *
+ * @return The statistics of the last run.
+ */
+CsvQueryStats csvQueryGetStats(const CsvQuery*);
+
+/**
+ * Build the row index of a CSV file and store it next to the file, in <csvFilePath>.idx.
+ * The index has the offset of one row every rowsPerEntry rows. processCsvFile and the csvQueryRunFile functions use it
+ * to split the rows between threads and to find the rows of csvQueryRunFileRowsToSink without scanning the file.
+ * The index stores the size and the modification time of the file and a checksum of its header, and it's ignored
+ * once the file changes. It's only used by queries with the same quoting (CSV_QUOTES_NONE or not) it was built with.
+ *
+ * @param csvFilePath The path of the CSV file. It must be a regular file.
+ * @param rowsPerEntry Rows between two entries of the index. 0 uses the default (1024).
+ * @param quoteMode The quoting of the queries that will use the index.
+ *
+ * @return 1 if the index was written, 0 otherwise (the error is printed).
+ */
+int csvBuildRowIndex(const char[], size_t, CsvQuoteMode);
+
+/**
+ * Build the zone map of a CSV file and store it next to the file, in <csvFilePath>.zmap.
+ * The zone map has the smallest and the largest value (lexicographically) of every column in each block of rowsPerBlock rows.
+ * processCsvFile and the csvQueryRunFile functions use it to skip the blocks whose rows can't satisfy the filters,
+ * which is most effective for range filters on sorted (or roughly sorted) columns. Typed filters never skip blocks.
+ * Like the row index, it's ignored once the file changes, and it's only used by queries with the same quoting.
+ * Queries with CSV_QUOTES_STRICT don't use it either, since the fields of a skipped block wouldn't be checked.
+ *
+ * @param csvFilePath The path of the CSV file. It must be a regular file.
+ * @param rowsPerBlock Rows of each block. 0 uses the default (4096).
+ * @param quoteMode The quoting of the queries that will use the zone map.
+ *
+ * @return 1 if the zone map was written, 0 otherwise (the error is printed).
+ */
+int csvBuildZoneMap(const char[], size_t, CsvQuoteMode);
+
+/**
+ * Build the columnar cache of a CSV file and store it next to the file, in <csvFilePath>.col.
+ * The cache is a binary copy of the file where the values of each column are stored together, so the rows are never
+ * split again and a query only reads the columns it selects or filters. While it's fresh, processCsvFile and the
+ * csvQueryRunFile functions answer the queries with the same quoting from the cache instead of the CSV file, with the
+ * same output. Like the row index, it's ignored once the file changes.
+ *
+ * @param csvFilePath The path of the CSV file. It must be a regular file.
+ * @param quoteMode The quoting of the queries that will use the cache.
+ * @param dictionaryEncode If not 0, the columns with fewer than 1000 distinct values store each value once
+ *                         and a code per row, and their filters are evaluated once per distinct value.
+ *
+ * @return 1 if the cache was written, 0 otherwise (the error is printed).
+ */
+int csvBuildColumnarCache(const char[], CsvQuoteMode, int);
+
+/**
+ * Force the instruction set used to find the commas and newlines of the CSV data.
+ * By default the fastest one supported by the CPU is picked at runtime (or the one in the
+ * CSV_PROCESSOR_SIMD environment variable). Every level produces exactly the same results.
+ *
+ * @param level "scalar", "sse2", "avx2" or "avx512", or "auto" to go back to the default level.
+ *
+ * @return 1 if the level exists and is supported by the CPU, 0 otherwise (the current level is kept).
+ */
+int setCsvScanLevel(const char[]);
+
+/**
+ * Set the number of threads used to process the CSV data. Big inputs are split at row boundaries
+ * in slices of about 1 MB (four per thread in each chunk), which the threads share by work stealing: a thread
+ * that is done takes the slices left to the others. Each slice writes its rows in its own buffer, and the buffers
+ * are appended in the order of the slices, so the rows are still written in their original order.
+ * The threads are created once and reused by the next calls.
+ * By default the CSV_PROCESSOR_THREADS environment variable is used, or the number of cores of the machine.
+ *
+ * @param threadCount The number of threads. Zero (or a negative value) goes back to the default.
+ *
+ * @return void
+ */
+void setCsvThreadCount(int);